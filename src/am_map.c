@@ -217,8 +217,8 @@ static int 	grid = 0;
 static int 	leveljuststarted = 1; 	// kluge until AM_LevelInit() is called
 
 boolean    	automapactive = false;
-static int 	finit_width = SCREENWIDTH;
-static int 	finit_height = SCREENHEIGHT - 32;
+static int 	finit_width = ORIGWIDTH;
+static int 	finit_height = ORIGHEIGHT - 32;
 
 // location of window on screen
 static int 	f_x;
@@ -536,6 +536,10 @@ void AM_LevelInit(void)
 {
     leveljuststarted = 0;
 
+    // the automap is drawn at the render resolution
+    finit_width = SCREENWIDTH;
+    finit_height = SCREENHEIGHT - SCALEY(32);
+
     f_x = f_y = 0;
     f_w = finit_width;
     f_h = finit_height;
@@ -1315,8 +1319,8 @@ void AM_drawMarks(void)
 	    h = 6; // because something's wrong with the wad, i guess
 	    fx = CXMTOF(markpoints[i].x);
 	    fy = CYMTOF(markpoints[i].y);
-	    if (fx >= f_x && fx <= f_w - w && fy >= f_y && fy <= f_h - h)
-		V_DrawPatch(fx, fy, FB, marknums[i]);
+	    if (fx >= f_x && fx <= f_w - SCALEX(w) && fy >= f_y && fy <= f_h - SCALEY(h))
+		V_DrawPatch(UNSCALEX(fx), UNSCALEY(fy), FB, marknums[i]);
 	}
     }
 
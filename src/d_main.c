@@ -63,6 +63,8 @@
 #include "i_system.h"
 #include "i_sound.h"
 #include "i_video.h"
+#include "m_profile.h"
+#include "i_thread.h"
 
 #include "g_game.h"
 
@@ -72,6 +74,7 @@
 #include "am_map.h"
 
 #include "p_setup.h"
+#include "p_tick.h"
 #include "r_local.h"
 
 
@@ -214,6 +217,69 @@ extern  boolean setsizeneeded;
 extern  int             showMessages;
 void R_ExecuteSetViewSize (void);
 
+
+//
+// D_BenchResolutions
+//  renders the current view at each scale factor resolution,
+//  reports the time per frame, then quits (-benchres)
+//
+static void D_BenchResolutions (void)
+{
+    static const int factors[9][2] =
+    {
+        {1,1}, {3,2}, {2,1}, {5,2}, {3,1}, {7,2}, {4,1}, {9,2}, {5,1}
+    };
+    player_t*   player = &players[displayplayer];
+    byte*       screen0 = screens[0];
+    int         width = screenwidth;
+    int         height = screenheight;
+    angle_t     angle = player->mo->angle;
+    byte*       buffer;
+    int64_t     start;
+    int64_t     elapsed;
+    int         i;
+    int         frame;
+
+    // the last resolution is the largest one
+    buffer = malloc ((ORIGWIDTH*5)*(ORIGHEIGHT*5));
+    if (!buffer)
+        I_Error ("D_BenchResolutions: couldn't allocate the screen");
+
+    I_Print ("D_BenchResolutions: %d frames per resolution", g_benchres);
+
+    for (i=0 ; i<9 ; i++)
+    {
+        screenwidth = ORIGWIDTH*factors[i][0]/factors[i][1];
+        screenheight = ORIGHEIGHT*factors[i][0]/factors[i][1];
+        screens[0] = buffer;
+        R_InitPlanes ();
+        R_ExecuteSetViewSize ();
+
+        // one full turn of the view over the frames
+        start = I_GetTimeNS ();
+        for (frame=0 ; frame<g_benchres ; frame++)
+        {
+            player->mo->angle = angle + frame*(ANG90/g_benchres)*4;
+            R_RenderPlayerView (player);
+        }
+        elapsed = I_GetTimeNS () - start;
+
+        I_Print ("D_BenchResolutions: %4dx%-4d %8.3f ms/frame",
+                 screenwidth, screenheight,
+                 (double) elapsed / 1000000.0 / g_benchres);
+    }
+
+    player->mo->angle = angle;
+    screenwidth = width;
+    screenheight = height;
+    screens[0] = screen0;
+    R_InitPlanes ();
+    R_ExecuteSetViewSize ();
+    free (buffer);
+
+    I_Quit ();
+}
+
 void D_Display (void)
 {
     static  boolean     viewactivestate    = false;
@@ -255,6 +321,10 @@ void D_Display (void)
         borderdrawcount = 3;
     }
 
+    // sweep the render resolutions, then quit
+    if (g_benchres && gamestate == GS_LEVEL && gametic)
+        D_BenchResolutions ();
+
     // save the current screen if about to wipe
     if (gamestate != wipegamestate)
     {
@@ -275,12 +345,12 @@ void D_Display (void)
                 break;
             if (automapactive)
                 AM_Drawer ();
-            if (g_wipe || (viewheight != 200 && fullscreen) )
+            if (g_wipe || (viewheight != SCREENHEIGHT && fullscreen) )
                 redrawsbar = true;
             if (inhelpscreensstate && !inhelpscreens)
                 redrawsbar = true; // just put away the help screen
-            ST_Drawer (viewheight == 200, redrawsbar );
-            fullscreen = viewheight == 200;
+            ST_Drawer (viewheight == SCREENHEIGHT, redrawsbar );
+            fullscreen = viewheight == SCREENHEIGHT;
             break;
 
         case GS_INTERMISSION:
@@ -299,9 +369,14 @@ void D_Display (void)
     // draw buffered stuff to screen
     I_UpdateNoBlit ();
     
-    // draw the view directly
+    // draw the view directly, between the last two tics if uncapped
     if (gamestate == GS_LEVEL && !automapactive && gametic)
+    {
+        if (g_uncapped && !singletics)
+            P_BeginInterpolation (I_GetTimeFrac ());
         R_RenderPlayerView (&players[displayplayer]);
+        P_EndInterpolation ();
+    }
 
     if (gamestate == GS_LEVEL && gametic)
         HU_Drawer ();
@@ -318,7 +393,7 @@ void D_Display (void)
     }
 
     // see if the border needs to be updated to the screen
-    if (gamestate == GS_LEVEL && !automapactive && scaledviewwidth != 320)
+    if (gamestate == GS_LEVEL && !automapactive && scaledviewwidth != SCREENWIDTH)
     {
         if (menuactive || menuactivestate || !viewactivestate)
             borderdrawcount = 3;
@@ -341,8 +416,8 @@ void D_Display (void)
         if (automapactive)
             y = 4;
         else
-            y = viewwindowy+4;
-        V_DrawPatchDirect(viewwindowx+(scaledviewwidth-68)/2,y,0,W_CacheLumpName ("M_PAUSE", PU_CACHE));
+            y = UNSCALEY(viewwindowy)+4;
+        V_DrawPatchDirect(UNSCALEX(viewwindowx)+(UNSCALEX(scaledviewwidth)-68)/2,y,0,W_CacheLumpName ("M_PAUSE", PU_CACHE));
     }
 
 
@@ -358,7 +433,9 @@ void D_Display (void)
         g_wipestart = I_GetTime ();
     }
     // normal update
+    PROF_BEGIN (prof_update);
     I_FinishUpdate (); // page flip or blit buffer
+    PROF_END (prof_update);
 }
 
 
@@ -367,6 +444,7 @@ void D_Display (void)
 //  D_DoomLoop
 //
 extern  boolean         demorecording;
+extern  boolean         timingdemo;
 
 void D_GameLoop(void)
 {
@@ -391,11 +469,20 @@ void D_GameLoop(void)
         TryRunTics (); // will run at least one tic
     }
 
+    PROF_BEGIN (prof_sounds);
     S_UpdateSounds (players[consoleplayer].mo);// move positional sounds
+    PROF_END (prof_sounds);
 
     // Update display, next frame, with current state.
     D_Display ();
 
+    // Time the frame during a timedemo.
+    if (timingdemo)
+        G_TimeDemoFrame ();
+
+    // Close the profiled frame.
+    PROF_FRAME ();
+
 #ifndef SNDSERV
     // Sound mixing for the buffer is snychronous.
     I_UpdateSound();
@@ -822,6 +909,84 @@ void FindResponseFile (void)
 }
 
 
+//
+// STARTUP STAGES
+// Run as a task graph once the WAD files are in:
+//  a stage waits for the ones it depends on, the
+//  independent ones run side by side. The sound and
+//  the network stay on the main thread.
+//
+enum
+{
+    init_menu,
+    init_data,
+    init_refresh,
+    init_playloop,
+    init_machine,
+    init_netgame,
+    init_sound,
+    init_hud,
+    init_statusbar,
+    NUMINITSTAGES
+};
+
+#define AFTER(stage)	(1u << (stage))
+
+static void D_InitSound (void)
+{
+    S_Init (snd_SfxVolume /* *8 */, snd_MusicVolume /* *8*/ );
+}
+
+static I_TaskNode	initstages[NUMINITSTAGES] =
+{
+    { "M_Init",		M_Init,		0,			0 },
+    { "R_InitData",	R_InitData,	0,			0 },
+    { "R_Init",		R_Init,		AFTER(init_data),	0 },
+    { "P_Init",		P_Init,		AFTER(init_data),	0 },
+    { "I_Init",		I_Init,		0,			1 },
+    { "D_CheckNetGame",	D_CheckNetGame,	0,			1 },
+    { "S_Init",		D_InitSound,	AFTER(init_machine),	1 },
+    { "HU_Init",	HU_Init,	0,			0 },
+    { "ST_Init",	ST_Init,	AFTER(init_netgame),	0 }
+};
+
+
+//
+// D_InitStages
+//
+static void D_InitStages (void)
+{
+    I_TaskNode*	stage;
+    int64_t	start;
+    int64_t	total;
+    int		threads;
+    int		i;
+
+    threads = g_initthreads;
+    if (threads == 0)
+	threads = I_GetNumProcessors ();
+    if (threads > NUMINITSTAGES)
+	threads = NUMINITSTAGES;
+
+    start = I_GetTimeNS ();
+    zoneshared = (threads > 1);
+    I_RunTaskGraph (initstages, NUMINITSTAGES, threads);
+    zoneshared = false;
+    start = I_GetTimeNS () - start;
+
+    total = 0;
+    for (i=0, stage=initstages ; i<NUMINITSTAGES ; i++, stage++)
+    {
+	I_Debug ("D_InitStages: %-16s %8.3f ms, from %8.3f ms, thread %i",
+		 stage->name, stage->time / 1e6, stage->start / 1e6, stage->thread);
+	total += stage->time;
+    }
+    I_Debug ("D_InitStages: %.3f ms on %i thread(s), %.3f ms in sequence",
+	     start / 1e6, threads, total / 1e6);
+}
+
+
+
 //
 // D_DoomMain
 //
@@ -1025,13 +1190,13 @@ void D_DoomMain (void)
     }
     
     // init subsystems
-    I_Debug ("V_Init: allocate screens.");
-    V_Init ();
-
     I_Debug ("M_LoadDefaults: Load system defaults.");
     M_LoadDefaults ();              // load before initing other systems
     I_ParseCommandLine ();          // override config file
 
+    I_Debug ("V_Init: allocate screens.");
+    V_Init ();                      // after the render resolution is known
+
     I_Debug ("Z_Init: Init zone memory allocation daemon. ");
     Z_Init ();
 
@@ -1099,29 +1264,7 @@ void D_DoomMain (void)
             break;
     }
 
-    I_Debug ("M_Init: Init miscellaneous info.");
-    M_Init ();
-
-    I_Debug ("R_Init: Init DOOM refresh daemon - ");
-    R_Init ();
-
-    I_Debug ("P_Init: Init Playloop state.");
-    P_Init ();
-
-    I_Debug ("I_Init: Setting up machine state.");
-    I_Init ();
-
-    I_Debug ("D_CheckNetGame: Checking network game status.");
-    D_CheckNetGame ();
-
-    I_Debug ("S_Init: Setting up sound.");
-    S_Init (snd_SfxVolume /* *8 */, snd_MusicVolume /* *8*/ );
-
-    I_Debug ("HU_Init: Setting up heads up display.");
-    HU_Init ();
-
-    I_Debug ("ST_Init: Init status bar.");
-    ST_Init ();
+    D_InitStages ();
 
     // check for a driver that wants intermission stats
     p = M_CheckParm ("-statcopy");
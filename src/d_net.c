@@ -29,6 +29,7 @@
 #include "g_game.h"
 #include "doomdef.h"
 #include "doomstat.h"
+#include "m_profile.h"
 
 #define	NCMD_EXIT		0x80000000
 #define	NCMD_RETRANSMIT		0x40000000
@@ -369,6 +370,8 @@ void NetUpdate (void)
     int				realstart;
     int				gameticdiv;
     
+    PROF_BEGIN (prof_net);
+
     // check time
     nowtime = I_GetTime ()/ticdup;
     newtics = nowtime - gametime;
@@ -407,7 +410,10 @@ void NetUpdate (void)
 
 
     if (singletics)
+    {
+	PROF_END (prof_net);
 	return;         // singletic update is syncronous
+    }
     
     // send the packet to the other nodes
     for (i=0 ; i<doomcom->numnodes ; i++)
@@ -439,6 +445,8 @@ void NetUpdate (void)
     // listen for other packets
   listen:
     GetPackets ();
+
+    PROF_END (prof_net);
 }
 
 
@@ -661,6 +669,10 @@ void TryRunTics (void)
     }
     availabletics = lowtic - gametic/ticdup;
     IGNORE_UNUSED(numplaying);
+
+    // uncapped, draw another frame rather than waiting
+    if (g_uncapped && availabletics < 1)
+	return;
     
     // decide how many tics to run
     if (realtics < availabletics-1)
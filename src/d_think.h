@@ -66,6 +66,10 @@ typedef struct thinker_s
     struct thinker_s*	prev;
     struct thinker_s*	next;
     think_t		function;
+
+    // list of the same type of thinkers
+    struct thinker_s*	cprev;
+    struct thinker_s*	cnext;
     
 } thinker_t;
 
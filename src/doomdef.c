@@ -29,6 +29,7 @@
 
 // Location for any defines turned variables.
 
-// None.
+int	screenwidth = ORIGWIDTH;
+int	screenheight = ORIGHEIGHT;
 
 
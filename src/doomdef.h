@@ -76,6 +76,12 @@ typedef enum
 // most parameter validation debugging code will not be compiled
 #define RANGECHECK
 
+// If profile is undefined, the profiling timers
+// and counters of m_profile.h are not compiled.
+// Else the timers only read the clock with -profile
+// or -profiledump.
+#define PROFILE
+
 // Do or do not use external soundserver.
 // The sndserver binary to be run separately
 //  has been introduced by Dave Taylor.
@@ -109,10 +115,29 @@ typedef enum
 // Defines suck. C sucks.
 // C++ might sucks for OOP, but it sure is a better C.
 // So there.
-#define SCREENWIDTH  320
-//SCREEN_MUL*BASE_WIDTH //320
-#define SCREENHEIGHT 200
-//(int)(SCREEN_MUL*BASE_WIDTH*INV_ASPECT_RATIO) //200
+#define ORIGWIDTH    320
+#define ORIGHEIGHT   200
+
+// The render resolution is selected at startup,
+//  see I_ParseCommandLine. The graphics are still
+//  laid out in the original 320x200 coordinates,
+//  the SCALE/UNSCALE macros convert between both.
+extern int	screenwidth;
+extern int	screenheight;
+
+#define SCREENWIDTH  screenwidth
+#define SCREENHEIGHT screenheight
+
+#define SCALEX(x)	((x)*SCREENWIDTH/ORIGWIDTH)
+#define SCALEY(y)	((y)*SCREENHEIGHT/ORIGHEIGHT)
+#define UNSCALEX(x)	((x)*ORIGWIDTH/SCREENWIDTH)
+#define UNSCALEY(y)	((y)*ORIGHEIGHT/SCREENHEIGHT)
+
+// Upper bounds of the render resolution, for -native WxH.
+// The tables are allocated from the resolution in use,
+//  these only keep the fixed point scales in range.
+#define MAXWIDTH     (ORIGWIDTH*8)
+#define MAXHEIGHT    (ORIGHEIGHT*8)
 
 
 
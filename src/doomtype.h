@@ -24,6 +24,8 @@
 #ifndef __DOOMTYPE__
 #define __DOOMTYPE__
 
+#include <stdint.h>
+
 
 #ifndef __BYTEBOOL__
 #define __BYTEBOOL__
@@ -152,7 +152,7 @@ wipe_initMelt
     // (y<0 => not ready to scroll yet)
     y = (int *) Z_Malloc(width*sizeof(int), PU_STATIC, 0);
     y[0] = -(M_Random()%16);
-    for (i=1;i<width;i++)
+    for (i=1;i<ORIGWIDTH;i++)
     {
 	r = (M_Random()%3) - 1;
 	y[i] = y[i-1] + r;
@@ -160,6 +160,11 @@ wipe_initMelt
 	else if (y[i] == -16) y[i] = -15;
     }
 
+    // stretch the 320 wide pattern over the screen columns,
+    //  backwards since the source index never exceeds i
+    for (i=width/2-1;i>=0;i--)
+	y[i] = y[(2*i*ORIGWIDTH/width)/2];
+
     return 0;
 }
 
@@ -190,7 +195,7 @@ wipe_doMelt
 	    }
 	    else if (y[i] < height)
 	    {
-		dy = (y[i] < 16) ? y[i]+1 : 8;
+		dy = (y[i] < SCALEY(16)) ? y[i]+1 : SCALEY(8);
 		if (y[i]+dy >= height) dy = height - y[i];
 		s = &((short *)wipe_scr_end)[i*height+y[i]];
 		d = &((short *)wipe_scr)[y[i]*width+i];
@@ -20,6 +20,8 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -88,6 +90,8 @@ void	G_DoCompleted (void);
 void	G_DoVictory (void); 
 void	G_DoWorldDone (void); 
 void	G_DoSaveGame (void); 
+
+static void G_StartTimeDemo (void);
  
  
 gameaction_t    gameaction; 
@@ -1134,7 +1138,10 @@ void G_DoCompleted (void)
     if (statcopy)
 	memcpy (statcopy, &wminfo, sizeof(wminfo));
 	
-    WI_Start (&wminfo); 
+    WI_Start (&wminfo);
+
+    // read the next level ahead during the intermission
+    P_PrefetchLevel (gameepisode, wminfo.next+1);
 } 
 
 
@@ -1621,21 +1628,263 @@ void G_DoPlayDemo (void)
 
     usergame = false; 
     demoplayback = true; 
+
+    if (timingdemo)
+	G_StartTimeDemo ();
 } 
 
 //
 // G_TimeDemo 
+// Every frame is timed on the monotonic clock.
+// With -repeat N, the demo is played N times;
+// the report goes to stdout, as JSON or as CSV (-csv).
 //
+typedef struct
+{
+    int		frames;
+    int		gametics;
+    double	total;		// all times in milliseconds
+    double	fps;
+    double	min;
+    double	max;
+    double	p50;
+    double	p95;
+    double	p99;
+} timedemorun_t;
+
+static int64_t*		timedemoframes;
+static int		numtimedemoframes;
+static int		maxtimedemoframes;
+static int64_t		timedemolast;
+static int		timedemotic;
+
+static timedemorun_t*	timedemoruns;
+static int		numtimedemoruns;
+static int		timedemorepeat;
+static boolean		timedemocsv;
+
 void G_TimeDemo (char* name) 
 { 	 
+    int		p;
+
     nodrawers = M_CheckParm ("-nodraw"); 
     noblit = M_CheckParm ("-noblit"); 
     timingdemo = true; 
     singletics = true; 
 
+    timedemorepeat = 1;
+    p = M_CheckParm ("-repeat");
+    if (p && p < myargc-1)
+	timedemorepeat = atoi (myargv[p+1]);
+    if (timedemorepeat < 1)
+	timedemorepeat = 1;
+    timedemocsv = M_CheckParm ("-csv");
+
+    timedemoruns = malloc (timedemorepeat*sizeof(*timedemoruns));
+    if (!timedemoruns)
+	I_Error ("G_TimeDemo: no memory for %i runs", timedemorepeat);
+    numtimedemoruns = 0;
+
     defdemoname = name; 
     gameaction = ga_playdemo; 
 } 
+
+
+//
+// G_StartTimeDemo
+// Called when the demo (re)starts.
+//
+static void G_StartTimeDemo (void)
+{
+    numtimedemoframes = 0;
+    timedemotic = gametic;
+    timedemolast = I_GetTimeNS ();
+}
+
+
+//
+// G_TimeDemoFrame
+// Called after each displayed frame.
+//
+void G_TimeDemoFrame (void)
+{
+    int64_t	now;
+
+    if (!timingdemo || !demoplayback)
+	return;
+
+    if (numtimedemoframes == maxtimedemoframes)
+    {
+	maxtimedemoframes = maxtimedemoframes ? maxtimedemoframes*2 : 4096;
+	timedemoframes = realloc (timedemoframes,
+				  maxtimedemoframes*sizeof(*timedemoframes));
+	if (!timedemoframes)
+	    I_Error ("G_TimeDemoFrame: no memory for %i frames",
+		     maxtimedemoframes);
+    }
+
+    now = I_GetTimeNS ();
+    timedemoframes[numtimedemoframes++] = now - timedemolast;
+    timedemolast = now;
+}
+
+
+static int G_CompareFrameTimes (const void* a, const void* b)
+{
+    int64_t	x = *(const int64_t*)a;
+    int64_t	y = *(const int64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+
+// nearest rank percentile of the sorted frame times, in ms
+static double G_FrameTimePercentile (int percent)
+{
+    int		rank;
+
+    rank = (numtimedemoframes*percent + 99) / 100;
+    if (rank < 1)
+	rank = 1;
+    return timedemoframes[rank-1] / 1e6;
+}
+
+
+//
+// G_EndTimeDemo
+// Computes the statistics of the run that just ended.
+//
+static void G_EndTimeDemo (void)
+{
+    timedemorun_t*	run;
+    int64_t		total;
+    int			i;
+
+    run = &timedemoruns[numtimedemoruns++];
+    memset (run, 0, sizeof(*run));
+    run->frames = numtimedemoframes;
+    run->gametics = gametic - timedemotic;
+
+    if (!numtimedemoframes)
+	return;
+
+    total = 0;
+    for (i=0 ; i<numtimedemoframes ; i++)
+	total += timedemoframes[i];
+
+    qsort (timedemoframes, numtimedemoframes, sizeof(*timedemoframes),
+	   G_CompareFrameTimes);
+
+    run->total = total / 1e6;
+    run->fps = total ? numtimedemoframes * 1e9 / total : 0;
+    run->min = timedemoframes[0] / 1e6;
+    run->max = timedemoframes[numtimedemoframes-1] / 1e6;
+    run->p50 = G_FrameTimePercentile (50);
+    run->p95 = G_FrameTimePercentile (95);
+    run->p99 = G_FrameTimePercentile (99);
+
+    I_Print ("G_TimeDemo: run %i, %i frames, %i gametics in %.3f ms, %.2f fps",
+	     numtimedemoruns, run->frames, run->gametics, run->total, run->fps);
+}
+
+
+// mean and variance of a field over all runs
+static void G_TimeDemoVariance (size_t offset, double* mean, double* variance)
+{
+    double	x;
+    int		i;
+
+    *mean = *variance = 0;
+    for (i=0 ; i<numtimedemoruns ; i++)
+	*mean += *(double*)((byte*)&timedemoruns[i] + offset);
+    *mean /= numtimedemoruns;
+
+    for (i=0 ; i<numtimedemoruns ; i++)
+    {
+	x = *(double*)((byte*)&timedemoruns[i] + offset) - *mean;
+	*variance += x*x;
+    }
+    if (numtimedemoruns > 1)
+	*variance /= numtimedemoruns - 1;
+}
+
+
+// prints a quoted JSON string, escaped
+static void G_PrintJSONString (char* s)
+{
+    unsigned char	c;
+
+    putchar ('"');
+    for ( ; (c = *s) ; s++)
+    {
+	if (c == '"' || c == '\\')
+	    printf ("\\%c", c);
+	else if (c < 0x20)
+	    printf ("\\u%04x", c);
+	else
+	    putchar (c);
+    }
+    putchar ('"');
+}
+
+
+//
+// G_TimeDemoReport
+// Prints the report of all runs on stdout.
+//
+static void G_TimeDemoReport (void)
+{
+    timedemorun_t*	run;
+    double		fpsmean;
+    double		fpsvar;
+    double		totalmean;
+    double		totalvar;
+    int			i;
+
+    G_TimeDemoVariance (offsetof(timedemorun_t, fps), &fpsmean, &fpsvar);
+    G_TimeDemoVariance (offsetof(timedemorun_t, total), &totalmean, &totalvar);
+
+    if (timedemocsv)
+    {
+	printf ("run,frames,gametics,total_ms,avg_fps,"
+		"min_ms,max_ms,p50_ms,p95_ms,p99_ms\n");
+	for (i=0 ; i<numtimedemoruns ; i++)
+	{
+	    run = &timedemoruns[i];
+	    printf ("%i,%i,%i,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+		    i+1, run->frames, run->gametics, run->total, run->fps,
+		    run->min, run->max, run->p50, run->p95, run->p99);
+	}
+	// across the runs, in the total and average fps columns
+	printf ("mean,,,%.3f,%.3f,,,,,\n", totalmean, fpsmean);
+	printf ("variance,,,%.3f,%.3f,,,,,\n", totalvar, fpsvar);
+	fflush (stdout);
+	return;
+    }
+
+    printf ("{\n");
+    printf ("  \"demo\": ");
+    G_PrintJSONString (defdemoname);
+    printf (",\n");
+    printf ("  \"runs\": [\n");
+    for (i=0 ; i<numtimedemoruns ; i++)
+    {
+	run = &timedemoruns[i];
+	printf ("    { \"frames\": %i, \"gametics\": %i, \"total_ms\": %.3f,"
+		" \"avg_fps\": %.3f, \"min_ms\": %.3f, \"max_ms\": %.3f,"
+		" \"p50_ms\": %.3f, \"p95_ms\": %.3f, \"p99_ms\": %.3f }%s\n",
+		run->frames, run->gametics, run->total, run->fps,
+		run->min, run->max, run->p50, run->p95, run->p99,
+		i < numtimedemoruns-1 ? "," : "");
+    }
+    printf ("  ],\n");
+    printf ("  \"avg_fps_mean\": %.3f,\n", fpsmean);
+    printf ("  \"avg_fps_variance\": %.3f,\n", fpsvar);
+    printf ("  \"total_ms_mean\": %.3f,\n", totalmean);
+    printf ("  \"total_ms_variance\": %.3f\n", totalvar);
+    printf ("}\n");
+    fflush (stdout);
+}
  
  
 /* 
@@ -1650,13 +1899,18 @@ void G_TimeDemo (char* name)
  
 boolean G_CheckDemoStatus (void) 
 { 
-    int             endtime; 
-	 
     if (timingdemo) 
     { 
-	endtime = I_GetTime (); 
-	I_Error ("timed %i gametics in %i realtics",gametic 
-		 , endtime-starttime); 
+	G_EndTimeDemo ();
+	if (numtimedemoruns < timedemorepeat)
+	{
+	    // play it again
+	    Z_ChangeTag (demobuffer, PU_CACHE); 
+	    gameaction = ga_playdemo;
+	    return true;
+	}
+	G_TimeDemoReport ();
+	I_Quit ();
     } 
 	 
     if (demoplayback) 
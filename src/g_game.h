@@ -58,6 +58,7 @@ void G_BeginRecording (void);
 
 void G_PlayDemo (char* name);
 void G_TimeDemo (char* name);
+void G_TimeDemoFrame (void);
 boolean G_CheckDemoStatus (void);
 
 void G_ExitLevel (void);
@@ -27,6 +27,9 @@
 #include "z_zone.h"
 
 #include "m_swap.h"
+#include "m_profile.h"
+
+#include "i_system.h"
 
 #include "hu_stuff.h"
 #include "hu_lib.h"
@@ -57,6 +60,11 @@
 #define HU_INPUTWIDTH	64
 #define HU_INPUTHEIGHT	1
 
+#define HU_PROFX	HU_MSGX
+#define HU_PROFY	(HU_INPUTY + HU_INPUTHEIGHT*(SHORT(hu_font[0]->height) +1))
+#define HU_PROFHEIGHT	4
+#define HU_PROFFRAMES	35	// about a second worth of frames
+
 
 
 char*	chat_macros[] =
@@ -99,6 +107,10 @@ static boolean		message_nottobefuckedwith;
 static hu_stext_t	w_message;
 static int		message_counter;
 
+#ifdef PROFILE
+static hu_textline_t	w_prof[HU_PROFHEIGHT];
+#endif
+
 extern int		showMessages;
 extern boolean		automapactive;
 
@@ -476,10 +488,64 @@ void HU_Start(void)
     for (i=0 ; i<MAXPLAYERS ; i++)
 	HUlib_initIText(&w_inputbuffer[i], 0, 0, 0, 0, &always_off);
 
+#ifdef PROFILE
+    // create the profile widgets
+    for (i=0 ; i<HU_PROFHEIGHT ; i++)
+	HUlib_initTextLine(&w_prof[i],
+			   HU_PROFX,
+			   HU_PROFY + i*(SHORT(hu_font[0]->height)+1),
+			   hu_font,
+			   HU_FONTSTART);
+#endif
+
     headsupactive = true;
 
 }
 
+#ifdef PROFILE
+//
+// HU_UpdateProfile
+// The profile overlay shows the last frames averaged,
+//  times in milliseconds.
+//
+static void HU_SetTextLine(hu_textline_t* t, char* s)
+{
+    HUlib_clearTextLine(t);
+    while (*s)
+	HUlib_addCharToTextLine(t, *(s++));
+}
+
+static void HU_UpdateProfile(void)
+{
+    profframe_t	avg;
+    char	buffer[HU_MAXLINELENGTH+1];
+
+    M_ProfileAverage(&avg, HU_PROFFRAMES);
+
+    snprintf(buffer, sizeof(buffer), "BSP %.2f PLN %.2f MSK %.2f DRW %.2f UPD %.2f",
+	     avg.times[prof_bsp] / 1e6, avg.times[prof_planes] / 1e6,
+	     avg.times[prof_masked] / 1e6, avg.times[prof_draw] / 1e6,
+	     avg.times[prof_update] / 1e6);
+    HU_SetTextLine(&w_prof[0], buffer);
+
+    snprintf(buffer, sizeof(buffer), "THK %.2f SPC %.2f SND %.2f NET %.2f",
+	     avg.times[prof_thinkers] / 1e6, avg.times[prof_specials] / 1e6,
+	     avg.times[prof_sounds] / 1e6, avg.times[prof_net] / 1e6);
+    HU_SetTextLine(&w_prof[1], buffer);
+
+    snprintf(buffer, sizeof(buffer), "COL %d SPN %d THK %d",
+	     avg.counts[prof_columns], avg.counts[prof_spans],
+	     avg.counts[prof_thinkerruns]);
+    HU_SetTextLine(&w_prof[2], buffer);
+
+    snprintf(buffer, sizeof(buffer), "VPL %d VSP %d DSG %d SGT %d/%d",
+	     avg.counts[prof_visplanes], avg.counts[prof_vissprites],
+	     avg.counts[prof_drawsegs], avg.counts[prof_sightcached],
+	     avg.counts[prof_sightcached] + avg.counts[prof_sighttraces]);
+    HU_SetTextLine(&w_prof[3], buffer);
+}
+#endif
+
 void HU_Drawer(void)
 {
 
@@ -488,6 +554,17 @@ void HU_Drawer(void)
     if (automapactive)
 	HUlib_drawTextLine(&w_title, false);
 
+#ifdef PROFILE
+    if (g_profile)
+    {
+	int i;
+
+	HU_UpdateProfile();
+	for (i=0 ; i<HU_PROFHEIGHT ; i++)
+	    HUlib_drawTextLine(&w_prof[i], false);
+    }
+#endif
+
 }
 
 void HU_Erase(void)
@@ -497,6 +574,16 @@ void HU_Erase(void)
     HUlib_eraseIText(&w_chat);
     HUlib_eraseTextLine(&w_title);
 
+#ifdef PROFILE
+    if (g_profile)
+    {
+	int i;
+
+	for (i=0 ; i<HU_PROFHEIGHT ; i++)
+	    HUlib_eraseTextLine(&w_prof[i]);
+    }
+#endif
+
 }
 
 void HU_Ticker(void)
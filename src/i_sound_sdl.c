@@ -316,6 +316,9 @@ static void I_AudioDriver_FiniSystem(I_AudioDriver* self)
 
 static void I_AudioDriver_InitSubSystem(I_AudioDriver* self)
 {
+    if(g_headless != 0) {
+        (void) SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+    }
     const int rc = SDL_InitSubSystem(SDL_INIT_AUDIO);
 
     if(rc != 0) {
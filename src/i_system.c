@@ -25,6 +25,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
@@ -34,8 +35,12 @@
 #include "m_misc.h"
 #include "i_video.h"
 #include "i_sound.h"
+#include "i_thread.h"
 #include "d_net.h"
 #include "g_game.h"
+#include "m_profile.h"
+#include "z_zone.h"
+#include "w_wad.h"
 #ifdef __GNUG__
 #pragma implementation "i_system.h"
 #endif
@@ -47,6 +52,34 @@ int g_scale_div  = -1;
 int g_scale_mode = -1;
 int g_quit_game  = 0;
 int g_mb_used    = 6;
+int g_mb_max     = 0;
+int g_initthreads = 0;
+int g_rthreads   = 1;
+int g_native_res = 0;
+int g_native_w   = 0;
+int g_native_h   = 0;
+int g_benchres   = 0;
+int g_simd       = 1;
+int g_simdtest   = 0;
+int g_uncapped   = 0;
+int g_sightcache = 1;
+int g_buildreject = 0;
+int g_buildblockmap = 0;
+int g_headless   = 0;
+int g_profile    = 0;
+int g_profiling  = 0;
+char* g_profile_file = NULL;
+int g_zonebench  = 0;
+int g_arena      = 1;
+int g_arenafit   = 0;
+int g_pool       = 1;
+int g_zonestats  = 0;
+int g_mmap       = 1;
+int g_lumpbudget = 0;
+int g_prefetch   = 1;
+char* g_lumpstats_file = NULL;
+char* g_levelcache_dir = NULL;
+char* g_datacache_file = NULL;
 
 void I_ParseCommandLine (void)
 {
@@ -98,6 +131,302 @@ void I_ParseCommandLine (void)
             }
         }
     }
+    /* parse command-line for scale factor */ {
+        int argi = 0;
+        int last = 0;
+        /* scale factor: 1.0 */ {
+            if((argi = M_CheckParm("-1")) && (argi > last)) {
+                g_scale_mul = 1;
+                g_scale_div = 1;
+                last = argi;
+            }
+        }
+        /* scale factor: 1.5 */ {
+            if((argi = M_CheckParm("-2")) && (argi > last)) {
+                g_scale_mul = 3;
+                g_scale_div = 2;
+                last = argi;
+            }
+        }
+        /* scale factor: 2.0 */ {
+            if((argi = M_CheckParm("-3")) && (argi > last)) {
+                g_scale_mul = 2;
+                g_scale_div = 1;
+                last = argi;
+            }
+        }
+        /* scale factor: 2.5 */ {
+            if((argi = M_CheckParm("-4")) && (argi > last)) {
+                g_scale_mul = 5;
+                g_scale_div = 2;
+                last = argi;
+            }
+        }
+        /* scale factor: 3.0 */ {
+            if((argi = M_CheckParm("-5")) && (argi > last)) {
+                g_scale_mul = 3;
+                g_scale_div = 1;
+                last = argi;
+            }
+        }
+        /* scale factor: 3.5 */ {
+            if((argi = M_CheckParm("-6")) && (argi > last)) {
+                g_scale_mul = 7;
+                g_scale_div = 2;
+                last = argi;
+            }
+        }
+        /* scale factor: 4.0 */ {
+            if((argi = M_CheckParm("-7")) && (argi > last)) {
+                g_scale_mul = 4;
+                g_scale_div = 1;
+                last = argi;
+            }
+        }
+        /* scale factor: 4.5 */ {
+            if((argi = M_CheckParm("-8")) && (argi > last)) {
+                g_scale_mul = 9;
+                g_scale_div = 2;
+                last = argi;
+            }
+        }
+        /* scale factor: 5.0 */ {
+            if((argi = M_CheckParm("-9")) && (argi > last)) {
+                g_scale_mul = 5;
+                g_scale_div = 1;
+                last = argi;
+            }
+        }
+        /* scale factor: sanity checks */ {
+            if((g_scale_mul <= 0)
+            || (g_scale_div <= 0)) {
+                g_scale_mul = 3;
+                g_scale_div = 1;
+            }
+        }
+    }
+    /* parse command-line for render resolution */ {
+        int argi = 0;
+        /* render resolution: native */ {
+            if((argi = M_CheckParm("-native"))) {
+                g_native_res = 1;
+                if((argi < myargc - 1) && (myargv[argi + 1][0] != '-')) {
+                    if(sscanf(myargv[argi + 1], "%dx%d", &g_native_w, &g_native_h) != 2) {
+                        g_native_w = 0;
+                        g_native_h = 0;
+                    }
+                }
+            }
+        }
+        /* render resolution: benchmark */ {
+            if((argi = M_CheckParm("-benchres"))) {
+                g_benchres = 16;
+                if((argi < myargc - 1) && (myargv[argi + 1][0] != '-')) {
+                    g_benchres = atoi(myargv[argi + 1]);
+                }
+                if(g_benchres <= 0) {
+                    g_benchres = 16;
+                }
+            }
+        }
+        /* render resolution: screen size */ {
+            if((g_native_res != 0) && (g_native_w > 0) && (g_native_h > 0)) {
+                screenwidth  = g_native_w;
+                screenheight = g_native_h;
+            }
+            else if(g_native_res != 0) {
+                screenwidth  = ((ORIGWIDTH  * g_scale_mul) / g_scale_div);
+                screenheight = ((ORIGHEIGHT * g_scale_mul) / g_scale_div);
+            }
+            else {
+                screenwidth  = ORIGWIDTH;
+                screenheight = ORIGHEIGHT;
+            }
+        }
+        /* render resolution: sanity checks */ {
+            if((screenwidth  < ORIGWIDTH ) || (screenwidth  > MAXWIDTH )
+            || (screenheight < ORIGHEIGHT) || (screenheight > MAXHEIGHT)) {
+                screenwidth  = ORIGWIDTH;
+                screenheight = ORIGHEIGHT;
+            }
+            /* the wipe moves pairs of pixels */
+            screenwidth  -= (screenwidth % 2);
+            /* the view and status bar heights are multiples of 8 rows in 320x200, */
+            /* so SCALEY keeps them whole when the height is a multiple of 200/8   */
+            screenheight -= (screenheight % (ORIGHEIGHT / 8));
+        }
+    }
+    /* parse command-line for startup */ {
+        int argi = 0;
+        /* startup: threads */ {
+            if((argi = M_CheckParm("-initthreads")) && (argi < myargc - 1)) {
+                g_initthreads = atoi(myargv[argi + 1]);
+            }
+        }
+        /* startup: sanity checks */ {
+            if(g_initthreads < 0) {
+                g_initthreads = 1;
+            }
+        }
+    }
+    /* parse command-line for render threads */ {
+        int argi = 0;
+        /* render threads: count */ {
+            if((argi = M_CheckParm("-rthreads")) && (argi < myargc - 1)) {
+                g_rthreads = atoi(myargv[argi + 1]);
+            }
+        }
+        /* render threads: sanity checks */ {
+            if(g_rthreads < 0) {
+                g_rthreads = 1;
+            }
+        }
+    }
+    /* parse command-line for video driver */ {
+        int argi = 0;
+        /* video driver: headless */ {
+            if((argi = M_CheckParm("-headless"))) {
+                g_headless = 1;
+            }
+        }
+    }
+    /* parse command-line for frame rate */ {
+        int argi = 0;
+        /* frame rate: uncapped */ {
+            if((argi = M_CheckParm("-uncapped"))) {
+                g_uncapped = 1;
+            }
+        }
+    }
+    /* parse command-line for play simulation */ {
+        int argi = 0;
+        /* play simulation: sight cache */ {
+            if((argi = M_CheckParm("-nosightcache"))) {
+                g_sightcache = 0;
+            }
+        }
+        /* play simulation: reject table */ {
+            if((argi = M_CheckParm("-buildreject"))) {
+                g_buildreject = 1;
+            }
+        }
+        /* play simulation: blockmap */ {
+            if((argi = M_CheckParm("-buildblockmap"))) {
+                g_buildblockmap = 1;
+            }
+        }
+    }
+    /* parse command-line for vectorized drawers */ {
+        int argi = 0;
+        /* vectorized drawers: disable */ {
+            if((argi = M_CheckParm("-nosimd"))) {
+                g_simd = 0;
+            }
+        }
+        /* vectorized drawers: self-test */ {
+            if((argi = M_CheckParm("-simdtest"))) {
+                g_simdtest = 1;
+            }
+        }
+    }
+    /* parse command-line for zone memory */ {
+        int argi = 0;
+        /* zone memory: benchmark */ {
+            if((argi = M_CheckParm("-zonebench"))) {
+                g_zonebench = 1;
+            }
+        }
+        /* zone memory: level arena */ {
+            if((argi = M_CheckParm("-noarena"))) {
+                g_arena = 0;
+            }
+        }
+        /* zone memory: level arena sized from the previous load */ {
+            if((argi = M_CheckParm("-arenafit"))) {
+                g_arenafit = 1;
+            }
+        }
+        /* zone memory: slab pools */ {
+            if((argi = M_CheckParm("-nopool"))) {
+                g_pool = 0;
+            }
+        }
+        /* zone memory: segment size */ {
+            if((argi = M_CheckParm("-zonemb")) && (argi < myargc - 1)) {
+                g_mb_used = atoi(myargv[argi + 1]);
+                if(g_mb_used < 1) {
+                    g_mb_used = 1;
+                }
+            }
+        }
+        /* zone memory: cap */ {
+            if((argi = M_CheckParm("-zonemax")) && (argi < myargc - 1)) {
+                g_mb_max = atoi(myargv[argi + 1]);
+                if(g_mb_max < 0) {
+                    g_mb_max = 0;
+                }
+            }
+        }
+        /* zone memory: usage on quit */ {
+            if((argi = M_CheckParm("-zonestats"))) {
+                g_zonestats = 1;
+            }
+        }
+    }
+    /* parse command-line for wad files */ {
+        int argi = 0;
+        /* wad files: memory mapped */ {
+            if((argi = M_CheckParm("-nommap"))) {
+                g_mmap = 0;
+            }
+        }
+        /* wad files: read ahead during the intermission */ {
+            if((argi = M_CheckParm("-noprefetch"))) {
+                g_prefetch = 0;
+            }
+        }
+        /* wad files: lump cache budget */ {
+            if((argi = M_CheckParm("-lumpbudget")) && (argi < myargc - 1)) {
+                g_lumpbudget = atoi(myargv[argi + 1]);
+                if(g_lumpbudget < 0) {
+                    g_lumpbudget = 0;
+                }
+            }
+        }
+        /* wad files: lump cache statistics */ {
+            if((argi = M_CheckParm("-lumpstats")) && (argi < myargc - 1)) {
+                g_lumpstats_file = myargv[argi + 1];
+            }
+        }
+        /* wad files: level cache */ {
+            if((argi = M_CheckParm("-levelcache")) && (argi < myargc - 1)) {
+                g_levelcache_dir = myargv[argi + 1];
+            }
+        }
+        /* wad files: texture and sprite tables cache */ {
+            if((argi = M_CheckParm("-datacache")) && (argi < myargc - 1)) {
+                g_datacache_file = myargv[argi + 1];
+            }
+        }
+    }
+    /* parse command-line for profiling */ {
+        int argi = 0;
+        /* profiling: overlay */ {
+            if((argi = M_CheckParm("-profile"))) {
+                g_profile = 1;
+            }
+        }
+        /* profiling: dump file */ {
+            if((argi = M_CheckParm("-profiledump")) && (argi < myargc - 1)) {
+                g_profile_file = myargv[argi + 1];
+            }
+        }
+        /* profiling: timers */ {
+            if((g_profile != 0) || (g_profile_file != NULL)) {
+                g_profiling = 1;
+            }
+        }
+    }
 }
 
 void I_Tactile (int on, int off, int total)
@@ -125,6 +454,47 @@ byte* I_ZoneBase (int* size)
     return (byte *) malloc (*size);
 }
 
+byte* I_ZoneSegment (int size)
+{
+    return (byte *) malloc (size);
+}
+
+void I_ZoneRelease (byte* segment)
+{
+    free (segment);
+}
+
+
+
+//
+// I_GetTimeNS
+// returns a monotonic time in nanoseconds,
+//  used for the tics, benchmarks and profiling
+//
+int64_t I_GetTimeNS (void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((int64_t) ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+
+//
+// I_GetTicTimeNS
+// returns the monotonic time since the first call,
+//  so that the wall clock steps leave the tics alone
+//
+static int64_t I_GetTicTimeNS (void)
+{
+    static int64_t basetime = 0;
+    int64_t now;
+
+    now = I_GetTimeNS();
+    if (!basetime)
+        basetime = now;
+    return now - basetime;
+}
 
 
 //
@@ -133,15 +503,21 @@ byte* I_ZoneBase (int* size)
 //
 int I_GetTime (void)
 {
-    static int basetime = 0;
-    struct timeval tp;
-    int newtics;
+    return (int) ((I_GetTicTimeNS() * TICRATE) / 1000000000);
+}
 
-    gettimeofday(&tp, NULL);
-    if (!basetime)
-        basetime = tp.tv_sec;
-    newtics = (tp.tv_sec-basetime)*TICRATE + tp.tv_usec*TICRATE/1000000;
-    return newtics;
+
+//
+// I_GetTimeFrac
+// returns the time elapsed in the current tic,
+//  in 1/FRACUNIT of a tic, on the I_GetTime clock
+//
+fixed_t I_GetTimeFrac (void)
+{
+    int64_t frac;
+
+    frac = (I_GetTicTimeNS() * TICRATE) % 1000000000;
+    return (fixed_t) ((frac * FRACUNIT) / 1000000000);
 }
 
 
@@ -166,9 +542,18 @@ void I_Quit (void)
 
     D_QuitNetGame ();
     M_SaveDefaults ();
+    if (g_zonestats)
+        Z_PrintUsage ();
+    if ((g_lumpstats_file != NULL) && !W_Report (g_lumpstats_file))
+        I_Alert ("I_Quit: unable to write the lump statistics to %s", g_lumpstats_file);
+#ifdef PROFILE
+    if ((g_profile_file != NULL) && !M_ProfileDump (g_profile_file))
+        I_Alert ("I_Quit: unable to write the profile to %s", g_profile_file);
+#endif
     I_ShutdownSound ();
     I_ShutdownMusic ();
     I_ShutdownGraphics ();
+    I_ShutdownThreads ();
 #ifdef __EMSCRIPTEN__
     emscripten_cancel_main_loop();
     emscripten_force_exit(EXIT_SUCCESS);
@@ -25,6 +25,7 @@
 
 #include "d_ticcmd.h"
 #include "d_event.h"
+#include "m_fixed.h"
 
 #ifdef __GNUG__
 #pragma interface
@@ -37,6 +38,34 @@ extern int  g_scale_div;
 extern int  g_scale_mode;
 extern int  g_quit_game;
 extern int  g_mb_used;
+extern int  g_mb_max;
+extern int  g_initthreads;
+extern int  g_rthreads;
+extern int  g_native_res;
+extern int  g_native_w;
+extern int  g_native_h;
+extern int  g_benchres;
+extern int  g_simd;
+extern int  g_simdtest;
+extern int  g_uncapped;
+extern int  g_sightcache;
+extern int  g_buildreject;
+extern int  g_buildblockmap;
+extern int  g_headless;
+extern int  g_profile;
+extern int  g_profiling;
+extern char* g_profile_file;
+extern int  g_zonebench;
+extern int  g_arena;
+extern int  g_arenafit;
+extern int  g_pool;
+extern int  g_zonestats;
+extern int  g_mmap;
+extern int  g_lumpbudget;
+extern int  g_prefetch;
+extern char* g_lumpstats_file;
+extern char* g_levelcache_dir;
+extern char* g_datacache_file;
 
 enum {
     VERBOSE_QUIET = 0,
@@ -62,11 +91,22 @@ void I_Init (void);
 // for the zone management.
 byte* I_ZoneBase (int *size);
 
+// Called when the zone is full,
+// to add a segment of size bytes.
+byte* I_ZoneSegment (int size);
+void  I_ZoneRelease (byte* segment);
+
 
 // Called by D_DoomLoop,
 // returns current time in tics.
 int I_GetTime (void);
 
+// Time elapsed in the current tic, in 1/FRACUNIT of a tic.
+fixed_t I_GetTimeFrac (void);
+
+// Monotonic time in nanoseconds.
+int64_t I_GetTimeNS (void);
+
 
 //
 // Called by D_DoomLoop,
@@ -0,0 +1,530 @@
+/*
+ * i_thread.c - Copyright (c) 2024-2025 - Olivier Poncet
+ *
+ * DOOM - Copyright (C) 1993-1996 by id Software, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifndef __EMSCRIPTEN__
+#include <pthread.h>
+#endif
+#include "i_system.h"
+#include "i_thread.h"
+
+// ---------------------------------------------------------------------------
+// some useful stuff
+// ---------------------------------------------------------------------------
+
+#define MAXTHREADS 64
+
+// ---------------------------------------------------------------------------
+// I_ThreadPool instance
+// ---------------------------------------------------------------------------
+
+typedef struct I_ThreadPoolRec I_ThreadPool;
+
+struct I_ThreadPoolRec
+{
+#ifndef __EMSCRIPTEN__
+    pthread_t       threads[MAXTHREADS];
+    pthread_mutex_t mutex;
+    pthread_cond_t  start;
+    pthread_cond_t  done;
+#endif
+    I_ThreadFunc    func;
+    void*           data;
+    int             count;
+    int             generation;
+    int             pending;
+    int             quit;
+    int             refcount;
+};
+
+// ---------------------------------------------------------------------------
+// I_ThreadPool global instance
+// ---------------------------------------------------------------------------
+
+static I_ThreadPool g_thread_pool;
+
+// ---------------------------------------------------------------------------
+// I_ThreadPool private interface
+// ---------------------------------------------------------------------------
+
+#ifndef __EMSCRIPTEN__
+
+typedef struct I_ThreadArgRec I_ThreadArg;
+
+struct I_ThreadArgRec
+{
+    I_ThreadPool* pool;
+    int           index;
+};
+
+static I_ThreadArg g_thread_args[MAXTHREADS];
+
+static void* I_ThreadPool_Worker(void* arg)
+{
+    I_ThreadPool* self  = ((I_ThreadArg*) arg)->pool;
+    const int     index = ((I_ThreadArg*) arg)->index;
+    int           generation = 0;
+
+    for(;;) {
+        I_ThreadFunc func = NULL;
+        void*        data = NULL;
+        /* wait for a new job */ {
+            pthread_mutex_lock(&self->mutex);
+            while((self->generation == generation) && (self->quit == 0)) {
+                pthread_cond_wait(&self->start, &self->mutex);
+            }
+            if(self->quit != 0) {
+                pthread_mutex_unlock(&self->mutex);
+                break;
+            }
+            generation = self->generation;
+            func = self->func;
+            data = self->data;
+            pthread_mutex_unlock(&self->mutex);
+        }
+        /* run the job */ {
+            (*func)(data, index, self->count);
+        }
+        /* signal completion */ {
+            pthread_mutex_lock(&self->mutex);
+            if(--self->pending == 0) {
+                pthread_cond_signal(&self->done);
+            }
+            pthread_mutex_unlock(&self->mutex);
+        }
+    }
+    return NULL;
+}
+
+#endif
+
+static void I_ThreadPool_Init(I_ThreadPool* self, int count)
+{
+    if(self->refcount++ != 0) {
+        return;
+    }
+#ifdef __EMSCRIPTEN__
+    count = 1;
+#endif
+    if(count < 1) {
+        count = 1;
+    }
+    if(count > MAXTHREADS) {
+        count = MAXTHREADS;
+    }
+    self->func       = NULL;
+    self->data       = NULL;
+    self->count      = 1;
+    self->generation = 0;
+    self->pending    = 0;
+    self->quit       = 0;
+#ifndef __EMSCRIPTEN__
+    if(count > 1) {
+        pthread_mutex_init(&self->mutex, NULL);
+        pthread_cond_init(&self->start, NULL);
+        pthread_cond_init(&self->done, NULL);
+        for(int index = 1; index < count; ++index) {
+            I_ThreadArg* arg = &g_thread_args[index];
+            arg->pool  = self;
+            arg->index = index;
+            const int rc = pthread_create(&self->threads[index], NULL, &I_ThreadPool_Worker, arg);
+            if(rc != 0) {
+                I_Alert("I_Thread: pthread_create() has failed (%s)", strerror(rc));
+                break;
+            }
+            self->count = index + 1;
+        }
+    }
+#endif
+    I_Debug("I_Thread: %d thread(s) ready", self->count);
+}
+
+static void I_ThreadPool_Fini(I_ThreadPool* self)
+{
+    if(--self->refcount != 0) {
+        return;
+    }
+#ifndef __EMSCRIPTEN__
+    if(self->count > 1) {
+        pthread_mutex_lock(&self->mutex);
+        self->quit = 1;
+        pthread_cond_broadcast(&self->start);
+        pthread_mutex_unlock(&self->mutex);
+        for(int index = 1; index < self->count; ++index) {
+            pthread_join(self->threads[index], NULL);
+        }
+        pthread_cond_destroy(&self->done);
+        pthread_cond_destroy(&self->start);
+        pthread_mutex_destroy(&self->mutex);
+    }
+#endif
+    self->count = 1;
+}
+
+static void I_ThreadPool_Run(I_ThreadPool* self, I_ThreadFunc func, void* data)
+{
+    if(self->count <= 1) {
+        (*func)(data, 0, 1);
+        return;
+    }
+#ifndef __EMSCRIPTEN__
+    /* wake up the workers */ {
+        pthread_mutex_lock(&self->mutex);
+        self->func    = func;
+        self->data    = data;
+        self->pending = self->count - 1;
+        ++self->generation;
+        pthread_cond_broadcast(&self->start);
+        pthread_mutex_unlock(&self->mutex);
+    }
+    /* the caller runs the first share */ {
+        (*func)(data, 0, self->count);
+    }
+    /* wait for the workers */ {
+        pthread_mutex_lock(&self->mutex);
+        while(self->pending != 0) {
+            pthread_cond_wait(&self->done, &self->mutex);
+        }
+        pthread_mutex_unlock(&self->mutex);
+    }
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// I_Task instance
+// ---------------------------------------------------------------------------
+
+typedef struct I_TaskRec I_Task;
+
+struct I_TaskRec
+{
+#ifndef __EMSCRIPTEN__
+    pthread_t  thread;
+#endif
+    I_TaskFunc func;
+    void*      data;
+    int        running;
+};
+
+// ---------------------------------------------------------------------------
+// I_Task global instance
+// ---------------------------------------------------------------------------
+
+static I_Task g_task;
+
+// ---------------------------------------------------------------------------
+// I_Task private interface
+// ---------------------------------------------------------------------------
+
+#ifndef __EMSCRIPTEN__
+
+static void* I_Task_Worker(void* arg)
+{
+    I_Task* self = ((I_Task*) arg);
+
+    (*self->func)(self->data);
+
+    return NULL;
+}
+
+#endif
+
+static void I_Task_Wait(I_Task* self)
+{
+    if(self->running == 0) {
+        return;
+    }
+#ifndef __EMSCRIPTEN__
+    pthread_join(self->thread, NULL);
+#endif
+    self->running = 0;
+}
+
+static void I_Task_Start(I_Task* self, I_TaskFunc func, void* data)
+{
+    I_Task_Wait(self);
+    self->func = func;
+    self->data = data;
+#ifndef __EMSCRIPTEN__
+    /* run in the background */ {
+        const int rc = pthread_create(&self->thread, NULL, &I_Task_Worker, self);
+        if(rc == 0) {
+            self->running = 1;
+            return;
+        }
+        I_Alert("I_Thread: pthread_create() has failed (%s)", strerror(rc));
+    }
+#endif
+    /* run in the caller */ {
+        (*func)(data);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// I_Lock instance
+// ---------------------------------------------------------------------------
+
+#ifndef __EMSCRIPTEN__
+
+static pthread_mutex_t g_lock;
+static pthread_once_t  g_lock_once = PTHREAD_ONCE_INIT;
+
+static void I_Lock_Init(void)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&g_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// I_TaskGraph instance
+// ---------------------------------------------------------------------------
+
+typedef struct I_TaskGraphRec I_TaskGraph;
+
+struct I_TaskGraphRec
+{
+#ifndef __EMSCRIPTEN__
+    pthread_t       threads[MAXTHREADS];
+    pthread_mutex_t mutex;
+    pthread_cond_t  ready;
+#endif
+    I_TaskNode*     nodes;
+    int             count;
+    unsigned        claimed;
+    unsigned        done;
+    int64_t         origin;
+};
+
+typedef struct I_TaskGraphArgRec I_TaskGraphArg;
+
+struct I_TaskGraphArgRec
+{
+    I_TaskGraph* graph;
+    int          index;
+};
+
+// ---------------------------------------------------------------------------
+// I_TaskGraph private interface
+// ---------------------------------------------------------------------------
+
+static int I_TaskGraph_Next(I_TaskGraph* self, int index)
+{
+    for(int node = 0; node < self->count; ++node) {
+        const unsigned   bit  = (1u << node);
+        const I_TaskNode* task = &self->nodes[node];
+        if((self->claimed & bit) != 0) {
+            continue;
+        }
+        if((task->deps & ~self->done) != 0) {
+            continue;
+        }
+        if((task->main != 0) && (index != 0)) {
+            continue;
+        }
+        return node;
+    }
+    return -1;
+}
+
+static void I_TaskGraph_Exec(I_TaskGraph* self, int node, int index)
+{
+    I_TaskNode* task = &self->nodes[node];
+
+    task->thread = index;
+    task->start  = I_GetTimeNS() - self->origin;
+    (*task->func)();
+    task->time   = I_GetTimeNS() - self->origin - task->start;
+}
+
+static void I_TaskGraph_Serial(I_TaskGraph* self)
+{
+    int node = 0;
+
+    while((node = I_TaskGraph_Next(self, 0)) >= 0) {
+        self->claimed |= (1u << node);
+        I_TaskGraph_Exec(self, node, 0);
+        self->done |= (1u << node);
+    }
+}
+
+#ifndef __EMSCRIPTEN__
+
+static void I_TaskGraph_Loop(I_TaskGraph* self, int index)
+{
+    const unsigned all = (self->count < 32 ? (1u << self->count) - 1 : ~0u);
+
+    pthread_mutex_lock(&self->mutex);
+    while(self->done != all) {
+        const int node = I_TaskGraph_Next(self, index);
+        if(node < 0) {
+            pthread_cond_wait(&self->ready, &self->mutex);
+            continue;
+        }
+        self->claimed |= (1u << node);
+        pthread_mutex_unlock(&self->mutex);
+        /* run the task */ {
+            I_TaskGraph_Exec(self, node, index);
+        }
+        pthread_mutex_lock(&self->mutex);
+        self->done |= (1u << node);
+        pthread_cond_broadcast(&self->ready);
+    }
+    pthread_mutex_unlock(&self->mutex);
+}
+
+static void* I_TaskGraph_Worker(void* arg)
+{
+    I_TaskGraph* self  = ((I_TaskGraphArg*) arg)->graph;
+    const int    index = ((I_TaskGraphArg*) arg)->index;
+
+    I_TaskGraph_Loop(self, index);
+
+    return NULL;
+}
+
+#endif
+
+static void I_TaskGraph_Run(I_TaskGraph* self, int threads)
+{
+#ifndef __EMSCRIPTEN__
+    I_TaskGraphArg args[MAXTHREADS];
+    int            started = 1;
+
+    if(threads > MAXTHREADS) {
+        threads = MAXTHREADS;
+    }
+    if(threads > 1) {
+        pthread_mutex_init(&self->mutex, NULL);
+        pthread_cond_init(&self->ready, NULL);
+        for(int index = 1; index < threads; ++index) {
+            args[index].graph = self;
+            args[index].index = index;
+            const int rc = pthread_create(&self->threads[index], NULL, &I_TaskGraph_Worker, &args[index]);
+            if(rc != 0) {
+                I_Alert("I_Thread: pthread_create() has failed (%s)", strerror(rc));
+                break;
+            }
+            started = index + 1;
+        }
+        /* the caller runs the main thread tasks and helps */ {
+            I_TaskGraph_Loop(self, 0);
+        }
+        for(int index = 1; index < started; ++index) {
+            pthread_join(self->threads[index], NULL);
+        }
+        pthread_cond_destroy(&self->ready);
+        pthread_mutex_destroy(&self->mutex);
+        return;
+    }
+#endif
+    I_TaskGraph_Serial(self);
+}
+
+// ---------------------------------------------------------------------------
+// I_Thread interface
+// ---------------------------------------------------------------------------
+
+int I_GetNumProcessors(void)
+{
+#if defined(_SC_NPROCESSORS_ONLN) && !defined(__EMSCRIPTEN__)
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if(count > 0) {
+        return (count < MAXTHREADS ? (int) count : MAXTHREADS);
+    }
+#endif
+    return 1;
+}
+
+void I_InitThreads(int count)
+{
+    I_ThreadPool_Init(&g_thread_pool, count);
+}
+
+void I_ShutdownThreads(void)
+{
+    I_Task_Wait(&g_task);
+    I_ThreadPool_Fini(&g_thread_pool);
+}
+
+int I_GetNumThreads(void)
+{
+    return (g_thread_pool.count > 0 ? g_thread_pool.count : 1);
+}
+
+void I_RunThreads(I_ThreadFunc func, void* data)
+{
+    I_ThreadPool_Run(&g_thread_pool, func, data);
+}
+
+void I_StartTask(I_TaskFunc func, void* data)
+{
+    I_Task_Start(&g_task, func, data);
+}
+
+void I_WaitTask(void)
+{
+    I_Task_Wait(&g_task);
+}
+
+void I_Lock(void)
+{
+#ifndef __EMSCRIPTEN__
+    pthread_once(&g_lock_once, &I_Lock_Init);
+    pthread_mutex_lock(&g_lock);
+#endif
+}
+
+void I_Unlock(void)
+{
+#ifndef __EMSCRIPTEN__
+    pthread_mutex_unlock(&g_lock);
+#endif
+}
+
+void I_RunTaskGraph(I_TaskNode* nodes, int count, int threads)
+{
+    I_TaskGraph graph;
+
+    if((count < 0) || (count > 32)) {
+        I_Error("I_RunTaskGraph: %d tasks, 32 at most", count);
+    }
+    for(int node = 0; node < count; ++node) {
+        if((nodes[node].deps >> node) != 0) {
+            I_Error("I_RunTaskGraph: task %s depends on a later task", nodes[node].name);
+        }
+    }
+    graph.nodes   = nodes;
+    graph.count   = count;
+    graph.claimed = 0;
+    graph.done    = 0;
+    graph.origin  = I_GetTimeNS();
+    I_TaskGraph_Run(&graph, threads);
+}
+
+// ---------------------------------------------------------------------------
+// End-Of-File
+// ---------------------------------------------------------------------------
@@ -0,0 +1,73 @@
+/*
+ * i_thread.h - Copyright (c) 2024-2025 - Olivier Poncet
+ *
+ * DOOM - Copyright (C) 1993-1996 by id Software, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __I_THREAD__
+#define __I_THREAD__
+
+#include "doomtype.h"
+
+// ---------------------------------------------------------------------------
+// thread-local storage
+// ---------------------------------------------------------------------------
+
+#ifdef __EMSCRIPTEN__
+#define I_THREAD_LOCAL
+#else
+#define I_THREAD_LOCAL __thread
+#endif
+
+// ---------------------------------------------------------------------------
+// I_Thread types
+// ---------------------------------------------------------------------------
+
+typedef void (*I_ThreadFunc)(void* data, int index, int count);
+typedef void (*I_TaskFunc)(void* data);
+
+typedef struct I_TaskNodeRec I_TaskNode;
+
+struct I_TaskNodeRec
+{
+    const char* name;
+    void      (*func)(void);
+    unsigned    deps;   /* mask of the earlier tasks to wait for */
+    int         main;   /* must run on the calling thread        */
+    int         thread; /* set on return: thread index           */
+    int64_t     start;  /* set on return: ns from the graph start */
+    int64_t     time;   /* set on return: ns spent in the task    */
+};
+
+// ---------------------------------------------------------------------------
+// I_Thread interface
+// ---------------------------------------------------------------------------
+
+extern int  I_GetNumProcessors (void);
+extern void I_InitThreads      (int count);
+extern void I_ShutdownThreads  (void);
+extern int  I_GetNumThreads    (void);
+extern void I_RunThreads       (I_ThreadFunc func, void* data);
+extern void I_StartTask        (I_TaskFunc func, void* data);
+extern void I_WaitTask         (void);
+extern void I_Lock             (void);
+extern void I_Unlock           (void);
+extern void I_RunTaskGraph     (I_TaskNode* nodes, int count, int threads);
+
+// ---------------------------------------------------------------------------
+// End-Of-File
+// ---------------------------------------------------------------------------
+
+#endif
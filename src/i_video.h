@@ -31,6 +31,11 @@
 #endif
 
 
+// Receives each finished frame of the headless driver,
+//  width*height pixels in 0x00RRGGBB.
+typedef void (*I_FrameFunc) (void* data, const uint32_t* pixels, int width, int height);
+
+
 // Called by D_DoomMain,
 // determines the hardware configuration
 // and sets up the video mode
@@ -50,6 +55,9 @@ void I_WaitVBL(int count);
 
 void I_ReadScreen (byte* scr);
 
+// Sets the receiver of the headless frames, see -headless.
+void I_SetFrameCallback (I_FrameFunc func, void* data);
+
 void I_BeginRead (void);
 void I_EndRead (void);
 
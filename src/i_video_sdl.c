@@ -23,6 +23,10 @@
 #include <stdarg.h>
 #include <stdint.h>
 #include "i_video_sdl.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(__EMSCRIPTEN__)
+#define I_VIDEO_AVX2
+#include <immintrin.h>
+#endif
 
 // ---------------------------------------------------------------------------
 // some useful stuff
@@ -95,6 +99,82 @@ Overlay overlays[] = {
 };
 
 
+// ---------------------------------------------------------------------------
+// palette expansion
+// ---------------------------------------------------------------------------
+
+typedef void (*ExpandFunc)(const Uint32* palette, const Uint8* src, Uint32* dst, int count);
+
+static void ExpandPixels(const Uint32* palette, const Uint8* src, Uint32* dst, int count)
+{
+    while(count >= 4) {
+        dst[0] = palette[src[0]];
+        dst[1] = palette[src[1]];
+        dst[2] = palette[src[2]];
+        dst[3] = palette[src[3]];
+        src   += 4;
+        dst   += 4;
+        count -= 4;
+    }
+    while(count > 0) {
+        *dst++ = palette[*src++];
+        --count;
+    }
+}
+
+#ifdef I_VIDEO_AVX2
+
+__attribute__((target("avx2")))
+static void ExpandPixelsAVX2(const Uint32* palette, const Uint8* src, Uint32* dst, int count)
+{
+    while(count >= 8) {
+        const __m128i indices = _mm_loadl_epi64((const __m128i*) src);
+        const __m256i offsets = _mm256_cvtepu8_epi32(indices);
+        const __m256i pixels  = _mm256_i32gather_epi32((const int*) palette, offsets, 4);
+        _mm256_storeu_si256((__m256i*) dst, pixels);
+        src   += 8;
+        dst   += 8;
+        count -= 8;
+    }
+    ExpandPixels(palette, src, dst, count);
+}
+
+#endif
+
+static ExpandFunc g_expand_func = &ExpandPixels;
+
+// ---------------------------------------------------------------------------
+// frame capture
+// ---------------------------------------------------------------------------
+
+static int   g_capture_frame = 0;
+static char* g_capture_file  = NULL;
+
+static void CaptureFrame(void* data, const uint32_t* pixels, int width, int height)
+{
+    static int frame = 0;
+
+    if(++frame != g_capture_frame) {
+        return;
+    }
+    /* write a binary portable pixmap */ {
+        FILE* file = fopen(g_capture_file, "wb");
+        if(file == NULL) {
+            I_Alert("I_Video: unable to open '%s' (%s)", g_capture_file, strerror(errno));
+            return;
+        }
+        (void) fprintf(file, "P6\n%d %d\n255\n", width, height);
+        for(int index = 0; index < (width * height); ++index) {
+            const uint32_t pixel = pixels[index];
+            (void) fputc(((pixel >> 16) & 0xff), file);
+            (void) fputc(((pixel >>  8) & 0xff), file);
+            (void) fputc(((pixel >>  0) & 0xff), file);
+        }
+        (void) fclose(file);
+    }
+    I_Print("I_Video: frame %d captured to '%s'", frame, g_capture_file);
+}
+
 // ---------------------------------------------------------------------------
 // I_VideoDriver global instance
 // ---------------------------------------------------------------------------
@@ -103,10 +183,10 @@ static I_VideoDriver g_video_driver = {
     NULL, /* window    */
     NULL, /* renderer  */
     NULL, /* surface   */
-    NULL, /* palette   */
-    NULL, /* picture   */
+    { 0 },/* palette   */
     NULL, /* texture   */
     NULL, /* overlay   */
+    NULL, /* pixels    */
     NULL, /* screen0   */
     NULL, /* screen1   */
     NULL, /* screen2   */
@@ -127,6 +207,8 @@ static I_VideoDriver g_video_driver = {
     0,    /* touch_x   */
     0,    /* touch_y   */
     0,    /* touch_t   */
+    NULL, /* frame_func */
+    NULL, /* frame_data */
     0,    /* refcount  */
 };
 
@@ -178,80 +260,6 @@ static void I_VideoDriver_InitBegin(I_VideoDriver* self)
 {
     I_Debug("I_Video: Initializing...");
 
-    /* parse command-line for scale factor */ {
-        int argi = 0;
-        int last = 0;
-        /* scale factor: 1.0 */ {
-            if((argi = M_CheckParm("-1")) && (argi > last)) {
-                g_scale_mul = 1;
-                g_scale_div = 1;
-                last = argi;
-            }
-        }
-        /* scale factor: 1.5 */ {
-            if((argi = M_CheckParm("-2")) && (argi > last)) {
-                g_scale_mul = 3;
-                g_scale_div = 2;
-                last = argi;
-            }
-        }
-        /* scale factor: 2.0 */ {
-            if((argi = M_CheckParm("-3")) && (argi > last)) {
-                g_scale_mul = 2;
-                g_scale_div = 1;
-                last = argi;
-            }
-        }
-        /* scale factor: 2.5 */ {
-            if((argi = M_CheckParm("-4")) && (argi > last)) {
-                g_scale_mul = 5;
-                g_scale_div = 2;
-                last = argi;
-            }
-        }
-        /* scale factor: 3.0 */ {
-            if((argi = M_CheckParm("-5")) && (argi > last)) {
-                g_scale_mul = 3;
-                g_scale_div = 1;
-                last = argi;
-            }
-        }
-        /* scale factor: 3.5 */ {
-            if((argi = M_CheckParm("-6")) && (argi > last)) {
-                g_scale_mul = 7;
-                g_scale_div = 2;
-                last = argi;
-            }
-        }
-        /* scale factor: 4.0 */ {
-            if((argi = M_CheckParm("-7")) && (argi > last)) {
-                g_scale_mul = 4;
-                g_scale_div = 1;
-                last = argi;
-            }
-        }
-        /* scale factor: 4.5 */ {
-            if((argi = M_CheckParm("-8")) && (argi > last)) {
-                g_scale_mul = 9;
-                g_scale_div = 2;
-                last = argi;
-            }
-        }
-        /* scale factor: 5.0 */ {
-            if((argi = M_CheckParm("-9")) && (argi > last)) {
-                g_scale_mul = 5;
-                g_scale_div = 1;
-                last = argi;
-            }
-        }
-        /* scale factor: sanity checks */ {
-            if((g_scale_mul <= 0)
-            || (g_scale_div <= 0)) {
-                g_scale_mul = 3;
-                g_scale_div = 1;
-            }
-        }
-    }
     /* parse command-line for scale mode */ {
         int argi = 0;
         int last = 0;
@@ -282,6 +290,21 @@ static void I_VideoDriver_InitBegin(I_VideoDriver* self)
             }
         }
     }
+    /* parse command-line for frame capture */ {
+        int argi = 0;
+        /* frame capture: frame and file */ {
+            if((argi = M_CheckParm("-capture")) && (argi < myargc - 2)) {
+                g_capture_frame = atoi(myargv[argi + 1]);
+                g_capture_file  = myargv[argi + 2];
+            }
+        }
+        /* frame capture: sanity checks */ {
+            if((g_capture_frame > 0) && (g_headless != 0) && (self->frame_func == NULL)) {
+                self->frame_func = &CaptureFrame;
+                self->frame_data = NULL;
+            }
+        }
+    }
 }
 
 static void I_VideoDriver_InitEnd(I_VideoDriver* self)
@@ -323,11 +346,14 @@ static void I_VideoDriver_FiniSystem(I_VideoDriver* self)
 
 static void I_VideoDriver_InitSubSystem(I_VideoDriver* self)
 {
-    const int rc = SDL_InitSubSystem(SDL_INIT_VIDEO);
+    const int rc = (g_headless != 0 ? 0 : SDL_InitSubSystem(SDL_INIT_VIDEO));
 
     if(rc != 0) {
         I_Error("I_Video: SDL_InitSubSystem() has failed");
     }
+    else if(g_headless != 0) {
+        I_Debug("I_Video: headless, no video subsystem");
+    }
     else {
         I_Debug("I_Video: SDL_InitSubSystem() has succeeded");
     }
@@ -336,8 +362,8 @@ static void I_VideoDriver_InitSubSystem(I_VideoDriver* self)
         self->screen_h = SCREENHEIGHT;
         self->window_x = SDL_WINDOWPOS_UNDEFINED;
         self->window_y = SDL_WINDOWPOS_UNDEFINED;
-        self->window_w = ((self->screen_w * g_scale_mul) / g_scale_div);
-        self->window_h = ((self->screen_h * g_scale_mul) / g_scale_div);
+        self->window_w = ((ORIGWIDTH  * g_scale_mul) / g_scale_div);
+        self->window_h = ((ORIGHEIGHT * g_scale_mul) / g_scale_div);
         self->center_x = (self->window_w / 2);
         self->center_y = (self->window_h / 2);
         self->mouse_b  = 0;
@@ -352,6 +378,9 @@ static void I_VideoDriver_InitSubSystem(I_VideoDriver* self)
 
 static void I_VideoDriver_FiniSubSystem(I_VideoDriver* self)
 {
+    if(g_headless != 0) {
+        return;
+    }
     const int rc = (SDL_QuitSubSystem(SDL_INIT_VIDEO), 0);
 
     if(rc != 0) {
@@ -392,7 +421,7 @@ static void I_VideoDriver_FiniWindow(I_VideoDriver* self)
 static void I_VideoDriver_InitRenderer(I_VideoDriver* self)
 {
     const int    index = -1;
-    const Uint32 flags =  0;
+    const Uint32 flags = (g_uncapped != 0 ? SDL_RENDERER_PRESENTVSYNC : 0);
 
     if(self->renderer == NULL) {
         self->renderer = SDL_CreateRenderer(self->window, index, flags);
@@ -443,54 +472,23 @@ static void I_VideoDriver_FiniSurface(I_VideoDriver* self)
 
 static void I_VideoDriver_InitPalette(I_VideoDriver* self)
 {
-    if(self->palette == NULL) {
-        self->palette = SDL_AllocPalette(256);
-    }
-    if(self->palette == NULL) {
-        I_Error("I_Video: SDL_AllocPalette() has failed");
-    }
-    else {
-        I_Debug("I_Video: SDL_AllocPalette() has succeeded");
-    }
-    if(self->surface != NULL) {
-        SDL_SetSurfacePalette(self->surface, self->palette);
+    /* clear the lookup table */ {
+        (void) memset(self->palette, 0, sizeof(self->palette));
+    }
+    /* select the expansion loop */ {
+        g_expand_func = &ExpandPixels;
+#ifdef I_VIDEO_AVX2
+        __builtin_cpu_init();
+        if((g_simd != 0) && __builtin_cpu_supports("avx2")) {
+            g_expand_func = &ExpandPixelsAVX2;
+        }
+#endif
     }
 }
 
 static void I_VideoDriver_FiniPalette(I_VideoDriver* self)
 {
-    if(self->palette != NULL) {
-        self->palette = (SDL_FreePalette(self->palette), NULL);
-    }
-}
-
-static void I_VideoDriver_InitPicture(I_VideoDriver* self)
-{
-    const int    width  = self->screen_w;
-    const int    height = self->screen_h;
-    const int    depth  = 32;
-    const Uint32 rmask  = 0xff0000;
-    const Uint32 gmask  = 0x00ff00;
-    const Uint32 bmask  = 0x0000ff;
-    const Uint32 amask  = 0;
-    const Uint32 flags  = 0;
-
-    if(self->picture == NULL) {
-        self->picture = SDL_CreateRGBSurface(flags, width, height, depth, rmask, gmask, bmask, amask);
-    }
-    if(self->picture == NULL) {
-        I_Error("I_Video: SDL_CreateRGBSurface() has failed");
-    }
-    else {
-        I_Debug("I_Video: SDL_CreateRGBSurface() has succeeded");
-    }
-}
-
-static void I_VideoDriver_FiniPicture(I_VideoDriver* self)
-{
-    if(self->picture != NULL) {
-        self->picture = (SDL_FreeSurface(self->picture), NULL);
-    }
+    g_expand_func = &ExpandPixels;
 }
 
 static void I_VideoDriver_InitTexture(I_VideoDriver* self)
@@ -520,6 +518,26 @@ static void I_VideoDriver_FiniTexture(I_VideoDriver* self)
     }
 }
 
+static void I_VideoDriver_InitPixels(I_VideoDriver* self)
+{
+    if(self->pixels == NULL) {
+        self->pixels = calloc((self->screen_w * self->screen_h), sizeof(Uint32));
+    }
+    if(self->pixels == NULL) {
+        I_Error("I_Video: calloc() has failed");
+    }
+    else {
+        I_Debug("I_Video: calloc() has succeeded");
+    }
+}
+
+static void I_VideoDriver_FiniPixels(I_VideoDriver* self)
+{
+    if(self->pixels != NULL) {
+        self->pixels = (free(self->pixels), NULL);
+    }
+}
+
 static void I_VideoDriver_InitOverlay(I_VideoDriver* self)
 {
     if(self->overlay == NULL) {
@@ -584,13 +602,19 @@ static void I_VideoDriver_Init(I_VideoDriver* self)
         I_VideoDriver_InitBegin(self);
         I_VideoDriver_InitSystem(self);
         I_VideoDriver_InitSubSystem(self);
-        I_VideoDriver_InitWindow(self);
-        I_VideoDriver_InitRenderer(self);
+        if(g_headless == 0) {
+            I_VideoDriver_InitWindow(self);
+            I_VideoDriver_InitRenderer(self);
+        }
         I_VideoDriver_InitSurface(self);
         I_VideoDriver_InitPalette(self);
-        I_VideoDriver_InitPicture(self);
-        I_VideoDriver_InitTexture(self);
-        I_VideoDriver_InitOverlay(self);
+        if(g_headless == 0) {
+            I_VideoDriver_InitTexture(self);
+            I_VideoDriver_InitOverlay(self);
+        }
+        else {
+            I_VideoDriver_InitPixels(self);
+        }
         I_VideoDriver_InitScreens(self);
         I_VideoDriver_InitEnd(self);
     }
@@ -601,9 +625,9 @@ static void I_VideoDriver_Fini(I_VideoDriver* self)
     if(--self->refcount == 0) {
         I_VideoDriver_FiniBegin(self);
         I_VideoDriver_FiniScreens(self);
+        I_VideoDriver_FiniPixels(self);
         I_VideoDriver_FiniOverlay(self);
         I_VideoDriver_FiniTexture(self);
-        I_VideoDriver_FiniPicture(self);
         I_VideoDriver_FiniPalette(self);
         I_VideoDriver_FiniSurface(self);
         I_VideoDriver_FiniRenderer(self);
@@ -1138,6 +1162,9 @@ void I_VideoDriver_Video_StartFrame(I_VideoDriver* self)
 
 void I_VideoDriver_Video_ProcessEvents(I_VideoDriver* self)
 {
+    if(g_headless != 0) {
+        return;
+    }
     /* poll and dispatch sdl events */ {
         SDL_Event event;
         while(SDL_PollEvent(&event) != 0) {
@@ -1195,24 +1222,41 @@ void I_VideoDriver_Video_ProcessEvents(I_VideoDriver* self)
 
 void I_VideoDriver_Video_RenderFrame(I_VideoDriver* self)
 {
-    /* update picture */ {
-        SDL_BlitSurface(self->surface, NULL, self->picture, NULL);
-    }
-    /* update texture */ {
-        Uint32 img_format = self->picture->format->format;
-        int    img_width  = self->picture->w;
-        int    img_height = self->picture->h;
-        int    img_pitch  = self->picture->pitch;
-        void*  img_pixels = self->picture->pixels;
-        Uint32 tex_format = 0;
-        int    tex_width  = 0;
-        int    tex_height = 0;
-        int    tex_pitch  = 0;
-        void*  tex_pixels = NULL;
-        SDL_QueryTexture(self->texture, &tex_format, NULL, &tex_width, &tex_height);
-        SDL_LockTexture(self->texture, NULL, &tex_pixels, &tex_pitch);
-        SDL_ConvertPixels(img_width, img_height, img_format, img_pixels, img_pitch, tex_format, tex_pixels, tex_pitch);
-        SDL_UnlockTexture(self->texture);
+    if(g_headless != 0) {
+        /* expand the pixels into memory */ {
+            const Uint8* src_pixels = self->surface->pixels;
+            const int    src_pitch  = self->surface->pitch;
+            const int    src_width  = self->surface->w;
+            const int    src_height = self->surface->h;
+            Uint32*      dst_pixels = self->pixels;
+            for(int row = 0; row < src_height; ++row) {
+                (*g_expand_func)(self->palette, src_pixels, dst_pixels, src_width);
+                src_pixels += src_pitch;
+                dst_pixels += src_width;
+            }
+        }
+        /* hand the frame over */ {
+            if(self->frame_func != NULL) {
+                (*self->frame_func)(self->frame_data, self->pixels, self->screen_w, self->screen_h);
+            }
+        }
+        return;
+    }
+    /* expand the pixels into the texture */ {
+        const Uint8* src_pixels = self->surface->pixels;
+        const int    src_pitch  = self->surface->pitch;
+        const int    src_width  = self->surface->w;
+        const int    src_height = self->surface->h;
+        void*        tex_pixels = NULL;
+        int          tex_pitch  = 0;
+        if(SDL_LockTexture(self->texture, NULL, &tex_pixels, &tex_pitch) == 0) {
+            for(int row = 0; row < src_height; ++row) {
+                Uint32* dst_pixels = (Uint32*) ((Uint8*) tex_pixels + (row * tex_pitch));
+                (*g_expand_func)(self->palette, src_pixels, dst_pixels, src_width);
+                src_pixels += src_pitch;
+            }
+            SDL_UnlockTexture(self->texture);
+        }
     }
     /* blit to screen */ {
         SDL_RenderCopy(self->renderer, self->texture, NULL, NULL);
@@ -1231,19 +1275,21 @@ void I_VideoDriver_Video_ReadScreen(I_VideoDriver* self, byte* screen)
 
 void I_VideoDriver_Video_SetPalette(I_VideoDriver* self, byte* palette)
 {
-    const int count = self->palette->ncolors;
+    const int count = countof(self->palette);
     for(int index = 0; index < count; ++index) {
-        SDL_Color* color = &self->palette->colors[index];
-        color->r = gammatable[usegamma][*palette++];
-        color->g = gammatable[usegamma][*palette++];
-        color->b = gammatable[usegamma][*palette++];
-        color->a = 255;
-    }
-    if(++self->palette->version == 0) {
-        self->palette->version = 1;
+        const Uint32 r = gammatable[usegamma][*palette++];
+        const Uint32 g = gammatable[usegamma][*palette++];
+        const Uint32 b = gammatable[usegamma][*palette++];
+        self->palette[index] = ((r << 16) | (g << 8) | (b << 0));
     }
 }
 
+void I_VideoDriver_Video_SetCallback(I_VideoDriver* self, I_FrameFunc func, void* data)
+{
+    self->frame_func = func;
+    self->frame_data = data;
+}
+
 // ---------------------------------------------------------------------------
 // DOOM video interface
 // ---------------------------------------------------------------------------
@@ -1288,6 +1334,11 @@ void I_SetPalette(byte* palette)
     I_VideoDriver_Video_SetPalette(&g_video_driver, palette);
 }
 
+void I_SetFrameCallback(I_FrameFunc func, void* data)
+{
+    I_VideoDriver_Video_SetCallback(&g_video_driver, func, data);
+}
+
 // ---------------------------------------------------------------------------
 // End-Of-File
 // ---------------------------------------------------------------------------
@@ -47,10 +47,10 @@ struct I_VideoDriverRec
     SDL_Window*   window;
     SDL_Renderer* renderer;
     SDL_Surface*  surface;
-    SDL_Palette*  palette;
-    SDL_Surface*  picture;
+    Uint32        palette[256];
     SDL_Texture*  texture;
     SDL_Texture*  overlay;
+    Uint32*       pixels;
     void*         screen0;
     void*         screen1;
     void*         screen2;
@@ -71,6 +71,8 @@ struct I_VideoDriverRec
     int           touch_x;
     int           touch_y;
     int           touch_t;
+    I_FrameFunc   frame_func;
+    void*         frame_data;
     int           refcount;
 };
 
@@ -87,6 +89,7 @@ extern void I_VideoDriver_Video_UpdateFrame   (I_VideoDriver* self);
 extern void I_VideoDriver_Video_RenderFrame   (I_VideoDriver* self);
 extern void I_VideoDriver_Video_ReadScreen    (I_VideoDriver* self, byte* screen);
 extern void I_VideoDriver_Video_SetPalette    (I_VideoDriver* self, byte* palette);
+extern void I_VideoDriver_Video_SetCallback   (I_VideoDriver* self, I_FrameFunc func, void* data);
 
 // ---------------------------------------------------------------------------
 // End-Of-File
@@ -84,7 +84,7 @@ M_DrawText
 	}
 		
 	w = SHORT (hu_font[c]->width);
-	if (x+w > SCREENWIDTH)
+	if (x+w > ORIGWIDTH)
 	    break;
 	if (direct)
 	    V_DrawPatchDirect(x, y, 0, hu_font[c]);
@@ -99,6 +99,27 @@ M_DrawText
 
 
 
+//
+// M_HashBytes
+// 64 bits FNV-1a, start from M_HASHSEED.
+//
+uint64_t
+M_HashBytes
+( uint64_t	hash,
+  void*		data,
+  int		length )
+{
+    byte*	p;
+
+    for (p = data ; length-- > 0 ; p++)
+    {
+	hash ^= *p;
+	hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
 //
 // M_WriteFile
 //
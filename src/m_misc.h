@@ -31,6 +31,15 @@
 
 
 
+// Hashes the content of caches and files.
+#define M_HASHSEED	0xcbf29ce484222325ULL
+
+uint64_t
+M_HashBytes
+( uint64_t	hash,
+  void*		data,
+  int		length );
+
 boolean
 M_WriteFile
 ( char const*	name,
@@ -0,0 +1,139 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	Profiling timers and counters.
+//	Every displayed frame is kept in a ring buffer,
+//	 averaged by the HUD overlay and dumped on quit.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+
+#include "m_profile.h"
+
+#ifdef PROFILE
+
+profframe_t		profframe;
+
+static profframe_t	profframes[PROFFRAMES];
+static int		numprofframes;	// frames closed so far
+
+static char*		proftimernames[NUMPROFTIMERS] =
+{
+    "bsp", "planes", "masked", "draw", "thinkers",
+    "specials", "sounds", "update", "net"
+};
+
+static char*		profcounternames[NUMPROFCOUNTERS] =
+{
+    "columns", "spans", "visplanes", "vissprites",
+    "drawsegs", "thinkers", "sighttraces", "sightcached"
+};
+
+
+//
+// M_ProfileFrame
+// Called once per displayed frame.
+//
+void M_ProfileFrame (void)
+{
+    profframes[numprofframes%PROFFRAMES] = profframe;
+    numprofframes++;
+    memset (&profframe, 0, sizeof(profframe));
+}
+
+
+//
+// M_ProfileAverage
+//
+int M_ProfileAverage (profframe_t* avg, int count)
+{
+    profframe_t*	frame;
+    int			i;
+    int			j;
+
+    memset (avg, 0, sizeof(*avg));
+
+    if (count > numprofframes)
+	count = numprofframes;
+    if (count > PROFFRAMES)
+	count = PROFFRAMES;
+    if (count <= 0)
+	return 0;
+
+    for (i=numprofframes-count ; i<numprofframes ; i++)
+    {
+	frame = &profframes[i%PROFFRAMES];
+	for (j=0 ; j<NUMPROFTIMERS ; j++)
+	    avg->times[j] += frame->times[j];
+	for (j=0 ; j<NUMPROFCOUNTERS ; j++)
+	    avg->counts[j] += frame->counts[j];
+    }
+
+    for (j=0 ; j<NUMPROFTIMERS ; j++)
+	avg->times[j] /= count;
+    for (j=0 ; j<NUMPROFCOUNTERS ; j++)
+	avg->counts[j] /= count;
+
+    return count;
+}
+
+
+//
+// M_ProfileDump
+// One line per frame, oldest first,
+//  times in milliseconds.
+//
+boolean M_ProfileDump (char* filename)
+{
+    FILE*		handle;
+    profframe_t*	frame;
+    int			first;
+    int			i;
+    int			j;
+
+    handle = fopen (filename, "w");
+    if (!handle)
+	return false;
+
+    fprintf (handle, "frame");
+    for (j=0 ; j<NUMPROFTIMERS ; j++)
+	fprintf (handle, ",%s_ms", proftimernames[j]);
+    for (j=0 ; j<NUMPROFCOUNTERS ; j++)
+	fprintf (handle, ",%s", profcounternames[j]);
+    fprintf (handle, "\n");
+
+    first = numprofframes > PROFFRAMES ? numprofframes-PROFFRAMES : 0;
+    for (i=first ; i<numprofframes ; i++)
+    {
+	frame = &profframes[i%PROFFRAMES];
+	fprintf (handle, "%i", i);
+	for (j=0 ; j<NUMPROFTIMERS ; j++)
+	    fprintf (handle, ",%.3f", frame->times[j] / 1e6);
+	for (j=0 ; j<NUMPROFCOUNTERS ; j++)
+	    fprintf (handle, ",%i", frame->counts[j]);
+	fprintf (handle, "\n");
+    }
+
+    fclose (handle);
+    return true;
+}
+
+#endif
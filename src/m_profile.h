@@ -0,0 +1,114 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	Profiling timers and counters.
+//	Compiled out when PROFILE is undefined (doomdef.h).
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __M_PROFILE__
+#define __M_PROFILE__
+
+
+#include "doomtype.h"
+#include "doomdef.h"
+#include "i_system.h"
+
+
+// Timed phases, in nanoseconds per frame.
+typedef enum
+{
+    prof_bsp,		// R_RenderBSPNode
+    prof_planes,	// R_DrawPlanes
+    prof_masked,	// R_DrawMasked
+    prof_draw,		// R_FlushDrawCommands, with -rthreads
+    prof_thinkers,	// P_RunThinkers
+    prof_specials,	// P_UpdateSpecials
+    prof_sounds,	// S_UpdateSounds
+    prof_update,	// I_FinishUpdate
+    prof_net,		// NetUpdate
+    NUMPROFTIMERS
+
+} proftimer_t;
+
+// Counted events, per frame.
+typedef enum
+{
+    prof_columns,
+    prof_spans,
+    prof_visplanes,
+    prof_vissprites,
+    prof_drawsegs,
+    prof_thinkerruns,
+    prof_sighttraces,	// P_CheckSight through the BSP
+    prof_sightcached,	// P_CheckSight from the sight cache
+    NUMPROFCOUNTERS
+
+} profcounter_t;
+
+// One frame worth of timers and counters.
+typedef struct
+{
+    int64_t	times[NUMPROFTIMERS];
+    int		counts[NUMPROFCOUNTERS];
+
+} profframe_t;
+
+// Number of frames kept in the ring buffer.
+#define PROFFRAMES	1024
+
+
+#ifdef PROFILE
+
+// The frame being measured.
+extern profframe_t	profframe;
+
+// Closes the current frame into the ring buffer.
+void M_ProfileFrame (void);
+
+// Averages the last count frames into avg,
+//  returns the number of frames averaged.
+int M_ProfileAverage (profframe_t* avg, int count);
+
+// Writes the ring buffer to a CSV file.
+boolean M_ProfileDump (char* filename);
+
+// A timer can be started and stopped several
+//  times per frame, the time adds up.
+// The clock is not read unless profiling.
+#define PROF_BEGIN(t)	(g_profiling ? (void)(profframe.times[t] -= I_GetTimeNS ()) : (void)0)
+#define PROF_END(t)	(g_profiling ? (void)(profframe.times[t] += I_GetTimeNS ()) : (void)0)
+#define PROF_COUNT(c,n)	(profframe.counts[c] += (n))
+#define PROF_FRAME()	M_ProfileFrame ()
+
+#else
+
+#define PROF_BEGIN(t)	((void)0)
+#define PROF_END(t)	((void)0)
+#define PROF_COUNT(c,n)	((void)0)
+#define PROF_FRAME()	((void)0)
+
+#endif
+
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
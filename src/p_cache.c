@@ -0,0 +1,559 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	Level cache, the loaded geometry of a map on disk.
+//	The vertexes, sectors, sides, lines, subsectors, nodes,
+//	 segs, sector line tables and blockmap are written as
+//	 they are in memory, with the pointers made into offsets
+//	 from the start of the file. Loading reads the file
+//	 into a single level block and turns the offsets back
+//	 into pointers, in one pass.
+//	The file is keyed by a hash of the map lumps, the
+//	 texture definitions, the lump directory and the
+//	 structure sizes. Any change makes it stale.
+//	The REJECT tables built by -buildreject are kept
+//	 next to the level files, under the same key.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "i_system.h"
+#include "z_zone.h"
+#include "w_wad.h"
+#include "m_misc.h"
+
+#include "doomdef.h"
+#include "p_local.h"
+
+#include "doomstat.h"
+#include "r_state.h"
+
+#include "p_cache.h"
+
+
+#define CACHEMAGIC	"DLVC"
+#define CACHEVERSION	2
+
+typedef struct
+{
+    char	magic[4];
+    int		version;
+    uint64_t	key;
+    int		size;		// of the whole file
+
+    int		numvertexes;
+    int		numsectors;
+    int		numsides;
+    int		numlines;
+    int		numsubsectors;
+    int		numnodes;
+    int		numsegs;
+    int		numlinebuffer;
+    int		numblockmap;
+    int		numblockmaplump;
+
+    fixed_t	bmaporgx;
+    fixed_t	bmaporgy;
+    int		bmapwidth;
+    int		bmapheight;
+
+    // from the start of the file
+    int		vertexes;
+    int		sectors;
+    int		sides;
+    int		lines;
+    int		subsectors;
+    int		nodes;
+    int		segs;
+    int		linebuffer;
+    int		blockmap;
+    int		blockmaplump;
+
+} levelcache_t;
+
+// Sections start 8 bytes aligned, for the pointers.
+#define CACHEALIGN(n)	(((n) + 7) & ~7)
+
+
+//
+// P_HashLump
+//
+static uint64_t
+P_HashLump
+( uint64_t	hash,
+  int		lump )
+{
+    int		length;
+
+    if (lump < 0)
+	return hash;
+
+    length = W_LumpLength (lump);
+    hash = M_HashBytes (hash, &length, sizeof(length));
+    hash = M_HashBytes (hash, W_CacheLumpNum (lump, PU_CACHE), length);
+    return hash;
+}
+
+
+//
+// P_LevelCacheKey
+//
+static uint64_t P_LevelCacheKey (int lumpnum)
+{
+    uint64_t	hash;
+    int		sizes[10];
+    int		i;
+
+    hash = M_HASHSEED;
+
+    sizes[0] = CACHEVERSION;
+    sizes[1] = sizeof(vertex_t);
+    sizes[2] = sizeof(sector_t);
+    sizes[3] = sizeof(side_t);
+    sizes[4] = sizeof(line_t);
+    sizes[5] = sizeof(subsector_t);
+    sizes[6] = sizeof(node_t);
+    sizes[7] = sizeof(seg_t);
+    sizes[8] = sizeof(void *);
+    sizes[9] = g_buildblockmap;
+    hash = M_HashBytes (hash, sizes, sizeof(sizes));
+
+    // the flat and texture numbers depend on them
+    hash = M_HashBytes (hash, &numlumps, sizeof(numlumps));
+    for (i=0 ; i<numlumps ; i++)
+	hash = M_HashBytes (hash, lumpinfo[i].name, 8);
+    hash = P_HashLump (hash, W_CheckNumForName ("TEXTURE1"));
+    hash = P_HashLump (hash, W_CheckNumForName ("TEXTURE2"));
+
+    for (i=ML_THINGS ; i<=ML_BLOCKMAP ; i++)
+	hash = P_HashLump (hash, lumpnum+i);
+
+    return hash;
+}
+
+
+//
+// P_LevelCacheName
+//
+static void
+P_LevelCacheName
+( char*		lumpname,
+  char*		filename,
+  int		size )
+{
+    snprintf (filename, size, "%s/%s.lvl", g_levelcache_dir, lumpname);
+}
+
+
+//
+// P_WriteLevelCache
+//
+#define OFFSET(p,array,section) \
+    ((p) ? (void *)(uintptr_t)((section) + ((byte *)(p) - (byte *)(array))) : NULL)
+
+void
+P_WriteLevelCache
+( int		lumpnum,
+  char*		lumpname )
+{
+    levelcache_t*	header;
+    byte*		cache;
+    FILE*		handle;
+    char		filename[1024];
+    char		tempname[1024+8];
+    sector_t*		sector;
+    side_t*		side;
+    line_t*		line;
+    subsector_t*	ss;
+    seg_t*		seg;
+    line_t**		linebuffer;
+    int			size;
+    int			i;
+
+    if (!g_levelcache_dir)
+	return;
+
+    // lay out the sections
+    header = calloc (1, sizeof(*header));
+    if (!header)
+	return;
+
+    for (i=0 ; i<numsectors ; i++)
+	header->numlinebuffer += sectors[i].linecount;
+    header->numblockmap = bmapwidth*bmapheight;
+    header->numblockmaplump = blockmaplength;
+
+    size = CACHEALIGN(sizeof(levelcache_t));
+    header->vertexes = size;
+    size = CACHEALIGN(size + numvertexes*sizeof(vertex_t));
+    header->sectors = size;
+    size = CACHEALIGN(size + numsectors*sizeof(sector_t));
+    header->sides = size;
+    size = CACHEALIGN(size + numsides*sizeof(side_t));
+    header->lines = size;
+    size = CACHEALIGN(size + numlines*sizeof(line_t));
+    header->subsectors = size;
+    size = CACHEALIGN(size + numsubsectors*sizeof(subsector_t));
+    header->nodes = size;
+    size = CACHEALIGN(size + numnodes*sizeof(node_t));
+    header->segs = size;
+    size = CACHEALIGN(size + numsegs*sizeof(seg_t));
+    header->linebuffer = size;
+    size = CACHEALIGN(size + header->numlinebuffer*sizeof(line_t *));
+    header->blockmap = size;
+    size = CACHEALIGN(size + header->numblockmap*sizeof(int));
+    header->blockmaplump = size;
+    size = CACHEALIGN(size + header->numblockmaplump*sizeof(int));
+
+    cache = calloc (1, size);
+    if (!cache)
+    {
+	free (header);
+	return;
+    }
+
+    memcpy (header->magic, CACHEMAGIC, 4);
+    header->version = CACHEVERSION;
+    header->key = P_LevelCacheKey (lumpnum);
+    header->size = size;
+    header->numvertexes = numvertexes;
+    header->numsectors = numsectors;
+    header->numsides = numsides;
+    header->numlines = numlines;
+    header->numsubsectors = numsubsectors;
+    header->numnodes = numnodes;
+    header->numsegs = numsegs;
+    header->bmaporgx = bmaporgx;
+    header->bmaporgy = bmaporgy;
+    header->bmapwidth = bmapwidth;
+    header->bmapheight = bmapheight;
+    memcpy (cache, header, sizeof(*header));
+
+    memcpy (cache+header->vertexes, vertexes, numvertexes*sizeof(vertex_t));
+    memcpy (cache+header->sectors, sectors, numsectors*sizeof(sector_t));
+    memcpy (cache+header->sides, sides, numsides*sizeof(side_t));
+    memcpy (cache+header->lines, lines, numlines*sizeof(line_t));
+    memcpy (cache+header->subsectors, subsectors, numsubsectors*sizeof(subsector_t));
+    memcpy (cache+header->nodes, nodes, numnodes*sizeof(node_t));
+    memcpy (cache+header->segs, segs, numsegs*sizeof(seg_t));
+    memcpy (cache+header->blockmap, blockmap, header->numblockmap*sizeof(int));
+    memcpy (cache+header->blockmaplump, blockmaplump, header->numblockmaplump*sizeof(int));
+
+    // pointers into the level, made into offsets,
+    //  the others are not set before the things spawn
+    sector = (sector_t *)(cache+header->sectors);
+    for (i=0 ; i<numsectors ; i++, sector++)
+    {
+	sector->lines = OFFSET(sector->lines, sectors[0].lines, header->linebuffer);
+	sector->soundtarget = NULL;
+	sector->thinglist = NULL;
+	sector->specialdata = NULL;
+	memset (&sector->soundorg.thinker, 0, sizeof(sector->soundorg.thinker));
+    }
+
+    side = (side_t *)(cache+header->sides);
+    for (i=0 ; i<numsides ; i++, side++)
+	side->sector = OFFSET(side->sector, sectors, header->sectors);
+
+    line = (line_t *)(cache+header->lines);
+    for (i=0 ; i<numlines ; i++, line++)
+    {
+	line->v1 = OFFSET(line->v1, vertexes, header->vertexes);
+	line->v2 = OFFSET(line->v2, vertexes, header->vertexes);
+	line->frontsector = OFFSET(line->frontsector, sectors, header->sectors);
+	line->backsector = OFFSET(line->backsector, sectors, header->sectors);
+	line->specialdata = NULL;
+    }
+
+    ss = (subsector_t *)(cache+header->subsectors);
+    for (i=0 ; i<numsubsectors ; i++, ss++)
+	ss->sector = OFFSET(ss->sector, sectors, header->sectors);
+
+    seg = (seg_t *)(cache+header->segs);
+    for (i=0 ; i<numsegs ; i++, seg++)
+    {
+	seg->v1 = OFFSET(seg->v1, vertexes, header->vertexes);
+	seg->v2 = OFFSET(seg->v2, vertexes, header->vertexes);
+	seg->sidedef = OFFSET(seg->sidedef, sides, header->sides);
+	seg->linedef = OFFSET(seg->linedef, lines, header->lines);
+	seg->frontsector = OFFSET(seg->frontsector, sectors, header->sectors);
+	seg->backsector = OFFSET(seg->backsector, sectors, header->sectors);
+    }
+
+    linebuffer = (line_t **)(cache+header->linebuffer);
+    for (i=0 ; i<header->numlinebuffer ; i++)
+	linebuffer[i] = OFFSET(sectors[0].lines[i], lines, header->lines);
+
+    // written aside then renamed, a process loading
+    //  the same map never reads half a file
+    P_LevelCacheName (lumpname, filename, sizeof(filename));
+    snprintf (tempname, sizeof(tempname), "%s.tmp", filename);
+
+    handle = fopen (tempname, "wb");
+    if (!handle)
+	I_Alert ("P_WriteLevelCache: unable to create %s", tempname);
+    else if ((fwrite (cache, size, 1, handle) != 1) | (fclose (handle) != 0)
+	     || rename (tempname, filename))
+    {
+	I_Alert ("P_WriteLevelCache: unable to write %s", filename);
+	remove (tempname);
+    }
+    else
+	I_Debug ("P_WriteLevelCache: %s, %i KB", filename, size / 1024);
+
+    free (cache);
+    free (header);
+}
+
+
+//
+// P_ReadLevelCache
+//
+#define FIXUP(p)	((p) = (p) ? (void *)(cache + (uintptr_t)(p)) : NULL)
+
+boolean
+P_ReadLevelCache
+( int		lumpnum,
+  char*		lumpname )
+{
+    levelcache_t	header;
+    byte*		cache;
+    FILE*		handle;
+    char		filename[1024];
+    sector_t*		sector;
+    side_t*		side;
+    line_t*		line;
+    subsector_t*	ss;
+    seg_t*		seg;
+    line_t**		linebuffer;
+    int			count;
+    int			i;
+
+    if (!g_levelcache_dir)
+	return false;
+
+    P_LevelCacheName (lumpname, filename, sizeof(filename));
+    handle = fopen (filename, "rb");
+    if (!handle)
+	return false;
+
+    if (fread (&header, sizeof(header), 1, handle) != 1
+	|| memcmp (header.magic, CACHEMAGIC, 4)
+	|| header.version != CACHEVERSION
+	|| header.size < (int)sizeof(header)
+	|| header.blockmaplump + header.numblockmaplump*(int)sizeof(int) > header.size
+	|| header.key != P_LevelCacheKey (lumpnum))
+    {
+	I_Debug ("P_ReadLevelCache: %s is stale", filename);
+	fclose (handle);
+	return false;
+    }
+
+    // the whole level in one block
+    cache = Z_Malloc (header.size, PU_LEVEL, 0);
+    memcpy (cache, &header, sizeof(header));
+    count = header.size - sizeof(header);
+    if (fread (cache + sizeof(header), count, 1, handle) != 1)
+    {
+	I_Alert ("P_ReadLevelCache: unable to read %s", filename);
+	fclose (handle);
+	Z_Free (cache);
+	return false;
+    }
+    fclose (handle);
+
+    numvertexes = header.numvertexes;
+    numsectors = header.numsectors;
+    numsides = header.numsides;
+    numlines = header.numlines;
+    numsubsectors = header.numsubsectors;
+    numnodes = header.numnodes;
+    numsegs = header.numsegs;
+
+    vertexes = (vertex_t *)(cache+header.vertexes);
+    sectors = (sector_t *)(cache+header.sectors);
+    sides = (side_t *)(cache+header.sides);
+    lines = (line_t *)(cache+header.lines);
+    subsectors = (subsector_t *)(cache+header.subsectors);
+    nodes = (node_t *)(cache+header.nodes);
+    segs = (seg_t *)(cache+header.segs);
+    linebuffer = (line_t **)(cache+header.linebuffer);
+
+    // the offsets back into pointers
+    for (i=0, sector=sectors ; i<numsectors ; i++, sector++)
+	FIXUP(sector->lines);
+
+    for (i=0, side=sides ; i<numsides ; i++, side++)
+	FIXUP(side->sector);
+
+    for (i=0, line=lines ; i<numlines ; i++, line++)
+    {
+	FIXUP(line->v1);
+	FIXUP(line->v2);
+	FIXUP(line->frontsector);
+	FIXUP(line->backsector);
+    }
+
+    for (i=0, ss=subsectors ; i<numsubsectors ; i++, ss++)
+	FIXUP(ss->sector);
+
+    for (i=0, seg=segs ; i<numsegs ; i++, seg++)
+    {
+	FIXUP(seg->v1);
+	FIXUP(seg->v2);
+	FIXUP(seg->sidedef);
+	FIXUP(seg->linedef);
+	FIXUP(seg->frontsector);
+	FIXUP(seg->backsector);
+    }
+
+    for (i=0 ; i<header.numlinebuffer ; i++)
+	FIXUP(linebuffer[i]);
+
+    // the blockmap, and empty thing chains
+    blockmap = (int *)(cache+header.blockmap);
+    blockmaplump = (int *)(cache+header.blockmaplump);
+    blockmaplength = header.numblockmaplump;
+    bmaporgx = header.bmaporgx;
+    bmaporgy = header.bmaporgy;
+    bmapwidth = header.bmapwidth;
+    bmapheight = header.bmapheight;
+
+    count = sizeof(*blocklinks)* bmapwidth*bmapheight;
+    blocklinks = Z_Malloc (count,PU_LEVEL, 0);
+    memset (blocklinks, 0, count);
+
+    I_Debug ("P_ReadLevelCache: %s, %i KB", filename, header.size / 1024);
+    return true;
+}
+
+
+//
+// REJECT CACHE
+// The table built for a map, next to its level cache,
+//  under the same key.
+//
+#define REJECTMAGIC	"DREJ"
+
+typedef struct
+{
+    char	magic[4];
+    int		version;
+    uint64_t	key;
+    int		size;		// of the table
+
+} rejectcache_t;
+
+
+//
+// P_RejectCacheName
+//
+static void
+P_RejectCacheName
+( char*		lumpname,
+  char*		filename,
+  int		size )
+{
+    snprintf (filename, size, "%s/%s.rej", g_levelcache_dir, lumpname);
+}
+
+
+//
+// P_WriteRejectCache
+//
+void
+P_WriteRejectCache
+( int		lumpnum,
+  char*		lumpname,
+  byte*		matrix,
+  int		size )
+{
+    rejectcache_t	header;
+    FILE*		handle;
+    char		filename[1024];
+    char		tempname[1024+8];
+
+    if (!g_levelcache_dir)
+	return;
+
+    memset (&header, 0, sizeof(header));
+    memcpy (header.magic, REJECTMAGIC, 4);
+    header.version = CACHEVERSION;
+    header.key = P_LevelCacheKey (lumpnum);
+    header.size = size;
+
+    P_RejectCacheName (lumpname, filename, sizeof(filename));
+    snprintf (tempname, sizeof(tempname), "%s.tmp", filename);
+
+    handle = fopen (tempname, "wb");
+    if (!handle)
+	I_Alert ("P_WriteRejectCache: unable to create %s", tempname);
+    else if ((fwrite (&header, sizeof(header), 1, handle) != 1)
+	     | (fwrite (matrix, size, 1, handle) != 1)
+	     | (fclose (handle) != 0)
+	     || rename (tempname, filename))
+    {
+	I_Alert ("P_WriteRejectCache: unable to write %s", filename);
+	remove (tempname);
+    }
+    else
+	I_Debug ("P_WriteRejectCache: %s, %i KB", filename, size / 1024);
+}
+
+
+//
+// P_ReadRejectCache
+//
+boolean
+P_ReadRejectCache
+( int		lumpnum,
+  char*		lumpname,
+  byte*		matrix,
+  int		size )
+{
+    rejectcache_t	header;
+    FILE*		handle;
+    char		filename[1024];
+    boolean		result;
+
+    if (!g_levelcache_dir)
+	return false;
+
+    P_RejectCacheName (lumpname, filename, sizeof(filename));
+    handle = fopen (filename, "rb");
+    if (!handle)
+	return false;
+
+    result = fread (&header, sizeof(header), 1, handle) == 1
+	&& !memcmp (header.magic, REJECTMAGIC, 4)
+	&& header.version == CACHEVERSION
+	&& header.size == size
+	&& header.key == P_LevelCacheKey (lumpnum)
+	&& fread (matrix, size, 1, handle) == 1;
+    fclose (handle);
+
+    if (!result)
+	I_Debug ("P_ReadRejectCache: %s is stale", filename);
+    else
+	I_Debug ("P_ReadRejectCache: %s", filename);
+    return result;
+}
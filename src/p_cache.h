@@ -0,0 +1,54 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	Level cache, the loaded geometry of a map on disk.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __P_CACHE__
+#define __P_CACHE__
+
+
+#ifdef __GNUG__
+#pragma interface
+#endif
+
+
+// Loads the geometry of the map at lumpnum, as left
+//  by P_GroupLines, from the -levelcache directory.
+// Returns false if there is no cache file, or if it
+//  was made from other lumps.
+boolean P_ReadLevelCache (int lumpnum, char* lumpname);
+
+// Saves the geometry just loaded.
+void P_WriteLevelCache (int lumpnum, char* lumpname);
+
+// Loads the REJECT table built for the map at lumpnum,
+//  size bytes, from the -levelcache directory.
+boolean P_ReadRejectCache (int lumpnum, char* lumpname, byte* matrix, int size);
+
+// Saves the REJECT table just built.
+void P_WriteRejectCache (int lumpnum, char* lumpname, byte* matrix, int size);
+
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
@@ -278,7 +278,7 @@ EV_DoDoor
 	// new door thinker
 	rtn = 1;
 	door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
-	P_AddThinker (&door->thinker);
+	P_AddThinker (&door->thinker, th_mover);
 	sec->specialdata = door;
 
 	door->thinker.function.acp1 = (actionf_p1) T_VerticalDoor;
@@ -454,7 +454,7 @@ EV_VerticalDoor
     
     // new door thinker
     door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
-    P_AddThinker (&door->thinker);
+    P_AddThinker (&door->thinker, th_mover);
     sec->specialdata = door;
     door->thinker.function.acp1 = (actionf_p1) T_VerticalDoor;
     door->sector = sec;
@@ -505,7 +505,7 @@ void P_SpawnDoorCloseIn30 (sector_t* sec)
 	
     door = Z_Malloc ( sizeof(*door), PU_LEVSPEC, 0);
 
-    P_AddThinker (&door->thinker);
+    P_AddThinker (&door->thinker, th_mover);
 
     sec->specialdata = door;
     sec->special = 0;
@@ -530,7 +530,7 @@ P_SpawnDoorRaiseIn5Mins
 	
     door = Z_Malloc ( sizeof(*door), PU_LEVSPEC, 0);
     
-    P_AddThinker (&door->thinker);
+    P_AddThinker (&door->thinker, th_mover);
 
     sec->specialdata = door;
     sec->special = 0;
@@ -740,7 +740,7 @@ EV_SlidingDoor
     if (!door)
     {
 	door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
-	P_AddThinker (&door->thinker);
+	P_AddThinker (&door->thinker, th_mover);
 	sec->specialdata = door;
 		
 	door->type = sdt_openAndClose;
@@ -53,6 +53,9 @@ T_MovePlane
     boolean	flag;
     fixed_t	lastpos;
 	
+    // the cached sight checks may go through this sector
+    sectorepoch++;
+
     switch(floorOrCeiling)
     {
       case 0:
@@ -276,7 +279,7 @@ EV_DoFloor
 	// new floor thinker
 	rtn = 1;
 	floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
-	P_AddThinker (&floor->thinker);
+	P_AddThinker (&floor->thinker, th_mover);
 	sec->specialdata = floor;
 	floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
 	floor->type = floortype;
@@ -479,7 +482,7 @@ EV_BuildStairs
 	// new floor thinker
 	rtn = 1;
 	floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
-	P_AddThinker (&floor->thinker);
+	P_AddThinker (&floor->thinker, th_mover);
 	sec->specialdata = floor;
 	floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
 	floor->direction = 1;
@@ -533,7 +536,7 @@ EV_BuildStairs
 		secnum = newsecnum;
 		floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
 
-		P_AddThinker (&floor->thinker);
+		P_AddThinker (&floor->thinker, th_mover);
 
 		sec->specialdata = floor;
 		floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
@@ -71,7 +71,7 @@ void P_SpawnFireFlicker (sector_t*	sector)
 	
     flick = Z_Malloc ( sizeof(*flick), PU_LEVSPEC, 0);
 
-    P_AddThinker (&flick->thinker);
+    P_AddThinker (&flick->thinker, th_light);
 
     flick->thinker.function.acp1 = (actionf_p1) T_FireFlicker;
     flick->sector = sector;
@@ -126,7 +126,7 @@ void P_SpawnLightFlash (sector_t*	sector)
 	
     flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
 
-    P_AddThinker (&flash->thinker);
+    P_AddThinker (&flash->thinker, th_light);
 
     flash->thinker.function.acp1 = (actionf_p1) T_LightFlash;
     flash->sector = sector;
@@ -183,7 +183,7 @@ P_SpawnStrobeFlash
 	
     flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
 
-    P_AddThinker (&flash->thinker);
+    P_AddThinker (&flash->thinker, th_light);
 
     flash->sector = sector;
     flash->darktime = fastOrSlow;
@@ -340,7 +340,7 @@ void P_SpawnGlowingLight(sector_t*	sector)
 	
     g = Z_Malloc( sizeof(*g), PU_LEVSPEC, 0);
 
-    P_AddThinker(&g->thinker);
+    P_AddThinker(&g->thinker, th_light);
 
     g->sector = sector;
     g->minlight = P_FindMinSurroundingLight(sector,sector->lightlevel);
@@ -69,9 +69,22 @@
 // both the head and tail of the thinker list
 extern	thinker_t	thinkercap;	
 
+// The thinkers again, by type, in the same order.
+typedef enum
+{
+    th_mobj,
+    th_mover,	// doors, floors, plats and ceilings
+    th_light,
+    NUMTHINKERTYPES
+
+} thinkertype_t;
+
+// heads and tails of the lists by type
+extern	thinker_t	thinkercaps[NUMTHINKERTYPES];
+
 
 void P_InitThinkers (void);
-void P_AddThinker (thinker_t* thinker);
+void P_AddThinker (thinker_t* thinker, thinkertype_t type);
 void P_RemoveThinker (thinker_t* thinker);
 
 
@@ -212,6 +225,11 @@ boolean P_TryMove (mobj_t* thing, fixed_t x, fixed_t y);
 boolean P_TeleportMove (mobj_t* thing, fixed_t x, fixed_t y);
 void	P_SlideMove (mobj_t* mo);
 boolean P_CheckSight (mobj_t* t1, mobj_t* t2);
+
+// Bumped whenever a floor or ceiling may have moved,
+//  drops the sight checks cached so far.
+extern int	sectorepoch;
+
 void 	P_UseLines (player_t* player);
 
 boolean P_ChangeSector (sector_t* sector, boolean crunch);
@@ -244,8 +262,9 @@ P_RadiusAttack
 // P_SETUP
 //
 extern byte*		rejectmatrix;	// for fast sight rejection
-extern short*		blockmaplump;	// offsets in blockmap are from here
-extern short*		blockmap;
+extern int*		blockmaplump;	// offsets in blockmap are from here
+extern int*		blockmap;
+extern int		blockmaplength;	// ints in blockmaplump
 extern int		bmapwidth;
 extern int		bmapheight;	// in mapblocks
 extern fixed_t		bmaporgx;
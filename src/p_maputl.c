@@ -471,7 +471,7 @@ P_BlockLinesIterator
   boolean(*func)(line_t*) )
 {
     int			offset;
-    short*		list;
+    int*		list;
     line_t*		ld;
 	
     if (x<0
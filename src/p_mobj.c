@@ -525,7 +525,7 @@ P_SpawnMobj
 
     mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
 	
-    P_AddThinker (&mobj->thinker);
+    P_AddThinker (&mobj->thinker, th_mobj);
 
     return mobj;
 }
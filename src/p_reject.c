@@ -0,0 +1,701 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	REJECT builder.
+//	A line of sight can only go from one sector to another
+//	 through two sided lines, crossing each of them once,
+//	 in order, from the near to the far side. From every
+//	 sector, the chains of two sided lines are followed
+//	 while some straight line can still go through all of
+//	 them: each line is clipped to the far side of the
+//	 source and pass lines, and between the two lines that
+//	 separate the source from the pass line. The sectors
+//	 never reached can not be seen.
+//	The heights are left out, so a pair is rejected only
+//	 when no line of sight can exist whatever the floors
+//	 and ceilings do.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "i_system.h"
+#include "i_thread.h"
+#include "z_zone.h"
+#include "w_wad.h"
+
+#include "doomdef.h"
+#include "p_local.h"
+#include "p_cache.h"
+
+#include "doomstat.h"
+#include "r_state.h"
+
+#include "p_reject.h"
+
+
+// Slack given to every side test, in map units,
+//  above the rounding of the sight trace itself.
+#define REJECTSLACK	4.0
+
+// Lines followed from one sector, and chain length,
+//  before giving up and taking every sector its two
+//  sided lines connect to as seen.
+#define REJECTSTEPS	(1<<18)
+#define REJECTDEPTH	256
+
+// Most two sided line sides given a table of the
+//  others they might see, a bit per pair.
+#define REJECTMIGHT	16384
+
+typedef struct
+{
+    double	x1, y1;
+    double	x2, y2;
+
+} rejectseg_t;
+
+// A two sided line seen from one of its sectors,
+//  the far sector is on the left of the segment.
+typedef struct
+{
+    rejectseg_t	seg;
+    int		line;
+    int		to;
+
+} rejectportal_t;
+
+typedef struct
+{
+    rejectportal_t*	portals;
+    int			numportals;
+    int*		firstportal;	// numsectors+1 entries
+    uint64_t*		mightsee;	// a row of bits per portal
+    int			mightwords;
+    byte*		visible;	// a row of bits per sector
+    int			rowbytes;
+    int			floods;		// sectors out of steps
+
+} rejectbuild_t;
+
+// One thread worth of flow state.
+typedef struct
+{
+    rejectbuild_t*	build;
+    byte*		row;
+    byte*		online;		// lines on the chain
+    uint64_t*		might;		// mightsee rows along the chain
+    int*		queue;
+    int			steps;
+
+} rejectflow_t;
+
+
+//
+// P_RejectSide
+// Distance of a point to the left of a line, scaled
+//  down by up to sqrt(2), which only adds slack.
+//
+static double
+P_RejectSide
+( rejectseg_t*	line,
+  double	x,
+  double	y )
+{
+    double	dx;
+    double	dy;
+    double	norm;
+
+    dx = line->x2 - line->x1;
+    dy = line->y2 - line->y1;
+    norm = (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy);
+    if (norm == 0)
+	return 0;
+
+    return (dx*(y - line->y1) - dy*(x - line->x1)) / norm;
+}
+
+
+//
+// P_RejectClip
+// Keeps the part of seg on the left of line,
+//  or on its right if side is -1.
+// Returns false if nothing is left.
+//
+static boolean
+P_RejectClip
+( rejectseg_t*	seg,
+  rejectseg_t*	line,
+  int		side )
+{
+    double	d1;
+    double	d2;
+    double	frac;
+    double	x;
+    double	y;
+
+    d1 = side*P_RejectSide (line, seg->x1, seg->y1) + REJECTSLACK;
+    d2 = side*P_RejectSide (line, seg->x2, seg->y2) + REJECTSLACK;
+
+    if (d1 < 0 && d2 < 0)
+	return false;
+    if (d1 >= 0 && d2 >= 0)
+	return true;
+
+    frac = d1 / (d1 - d2);
+    x = seg->x1 + frac*(seg->x2 - seg->x1);
+    y = seg->y1 + frac*(seg->y2 - seg->y1);
+
+    if (d1 < 0)
+    {
+	seg->x1 = x;
+	seg->y1 = y;
+    }
+    else
+    {
+	seg->x2 = x;
+	seg->y2 = y;
+    }
+    return true;
+}
+
+
+//
+// P_RejectSeparate
+// A line from an end of the source to an end of the
+//  pass segment with both on either side is crossed
+//  once, before the pass segment, so the target must
+//  be on the side of the pass segment.
+// Returns false if nothing of the target is left.
+//
+static boolean
+P_RejectSeparate
+( rejectseg_t*	target,
+  rejectseg_t*	source,
+  rejectseg_t*	pass )
+{
+    double	sx[2];
+    double	sy[2];
+    double	px[2];
+    double	py[2];
+    rejectseg_t	line;
+    double	s;
+    double	p;
+    int		i;
+    int		j;
+
+    sx[0] = source->x1; sy[0] = source->y1;
+    sx[1] = source->x2; sy[1] = source->y2;
+    px[0] = pass->x1; py[0] = pass->y1;
+    px[1] = pass->x2; py[1] = pass->y2;
+
+    for (i=0 ; i<2 ; i++)
+    {
+	for (j=0 ; j<2 ; j++)
+	{
+	    line.x1 = sx[i];
+	    line.y1 = sy[i];
+	    line.x2 = px[j];
+	    line.y2 = py[j];
+
+	    // shared vertex, no single line
+	    if ((line.x2-line.x1)*(line.x2-line.x1)
+		+ (line.y2-line.y1)*(line.y2-line.y1) < 1)
+		continue;
+
+	    s = P_RejectSide (&line, sx[i^1], sy[i^1]);
+	    p = P_RejectSide (&line, px[j^1], py[j^1]);
+
+	    if (s <= 0 && p > 0)
+	    {
+		if (!P_RejectClip (target, &line, 1))
+		    return false;
+	    }
+	    else if (s >= 0 && p < 0)
+	    {
+		if (!P_RejectClip (target, &line, -1))
+		    return false;
+	    }
+	}
+    }
+
+    return true;
+}
+
+
+//
+// P_RejectMightSee
+// The sides of two sided lines each side might see,
+//  at least partly beyond it while it is at least
+//  partly before them. Along a chain, only the sides
+//  all the previous ones might see are followed.
+//
+static void
+P_RejectMightSee
+( void*		data,
+  int		index,
+  int		count )
+{
+    rejectbuild_t*	build;
+    rejectportal_t*	portal;
+    rejectportal_t*	other;
+    rejectseg_t		seg;
+    uint64_t*		row;
+    int			i;
+    int			j;
+
+    build = data;
+
+    for (i=index ; i<build->numportals ; i+=count)
+    {
+	portal = &build->portals[i];
+	row = build->mightsee + i*build->mightwords;
+
+	for (j=0, other=build->portals ; j<build->numportals ; j++, other++)
+	{
+	    if (other->line == portal->line)
+		continue;
+	    seg = other->seg;
+	    if (!P_RejectClip (&seg, &portal->seg, 1))
+		continue;
+	    seg = portal->seg;
+	    if (!P_RejectClip (&seg, &other->seg, -1))
+		continue;
+	    row[j>>6] |= (uint64_t)1 << (j&63);
+	}
+    }
+}
+
+
+//
+// P_RejectUseful
+// Returns true if one of the portals in might
+//  leads to a sector not seen yet.
+//
+static boolean
+P_RejectUseful
+( rejectflow_t*	flow,
+  uint64_t*	might )
+{
+    rejectportal_t*	portal;
+    uint64_t		bits;
+    int			i;
+    int			j;
+
+    for (i=0 ; i<flow->build->mightwords ; i++)
+    {
+	bits = might[i];
+	portal = &flow->build->portals[i*64];
+	for (j=0 ; bits ; j++, bits >>= 1)
+	{
+	    if ((bits & 1)
+		&& !(flow->row[portal[j].to>>3] & (1 << (portal[j].to&7))))
+		return true;
+	}
+    }
+    return false;
+}
+
+
+//
+// P_RejectFlow
+// Follows the two sided lines of a sector that a line
+//  going through source, then pass, can cross.
+//
+static void
+P_RejectFlow
+( rejectflow_t*	flow,
+  int		sector,
+  rejectseg_t*	source,
+  rejectseg_t*	pass,
+  uint64_t*	might,
+  int		depth )
+{
+    rejectbuild_t*	build;
+    rejectportal_t*	portal;
+    rejectseg_t		seg;
+    rejectseg_t		from;
+    uint64_t*		next;
+    uint64_t*		mightsee;
+    int			i;
+    int			j;
+
+    build = flow->build;
+
+    if (depth > REJECTDEPTH)
+    {
+	flow->steps = 0;
+	return;
+    }
+
+    for (i=build->firstportal[sector] ; i<build->firstportal[sector+1] ; i++)
+    {
+	portal = &build->portals[i];
+	if (flow->online[portal->line])
+	    continue;
+	if (might && !(might[i>>6] & ((uint64_t)1 << (i&63))))
+	    continue;
+
+	if (flow->steps-- <= 0)
+	    return;
+
+	// beyond the source and the pass lines
+	seg = portal->seg;
+	if (!P_RejectClip (&seg, source, 1))
+	    continue;
+	if (pass
+	    && (!P_RejectClip (&seg, pass, 1)
+		|| !P_RejectSeparate (&seg, source, pass)))
+	    continue;
+
+	// and the source before this one
+	from = *source;
+	if (!P_RejectClip (&from, &portal->seg, -1))
+	    continue;
+
+	flow->row[portal->to>>3] |= 1 << (portal->to&7);
+
+	// nothing new to see down this chain
+	next = NULL;
+	if (might)
+	{
+	    next = flow->might + depth*build->mightwords;
+	    mightsee = build->mightsee + i*build->mightwords;
+	    for (j=0 ; j<build->mightwords ; j++)
+		next[j] = might[j] & mightsee[j];
+	    if (!P_RejectUseful (flow, next))
+		continue;
+	}
+
+	flow->online[portal->line] = 1;
+	P_RejectFlow (flow, portal->to, &from, &seg, next, depth+1);
+	flow->online[portal->line] = 0;
+    }
+}
+
+
+//
+// P_RejectFlood
+// Every sector connected to this one, when following
+//  the lines of sight went on for too long.
+//
+static void
+P_RejectFlood
+( rejectflow_t*	flow,
+  int		sector )
+{
+    rejectbuild_t*	build;
+    rejectportal_t*	portal;
+    int			head;
+    int			tail;
+    int			i;
+
+    build = flow->build;
+
+    memset (flow->row, 0, build->rowbytes);
+    flow->row[sector>>3] |= 1 << (sector&7);
+
+    head = tail = 0;
+    flow->queue[tail++] = sector;
+    while (head < tail)
+    {
+	sector = flow->queue[head++];
+	for (i=build->firstportal[sector] ; i<build->firstportal[sector+1] ; i++)
+	{
+	    portal = &build->portals[i];
+	    if (flow->row[portal->to>>3] & (1 << (portal->to&7)))
+		continue;
+	    flow->row[portal->to>>3] |= 1 << (portal->to&7);
+	    flow->queue[tail++] = portal->to;
+	}
+    }
+}
+
+
+//
+// P_RejectSource
+// Marks the sectors one sector might see.
+//
+static void
+P_RejectSource
+( rejectflow_t*	flow,
+  int		sector )
+{
+    rejectbuild_t*	build;
+    rejectportal_t*	portal;
+    int			i;
+
+    build = flow->build;
+    flow->row = build->visible + sector*build->rowbytes;
+    flow->steps = REJECTSTEPS;
+
+    flow->row[sector>>3] |= 1 << (sector&7);
+
+    for (i=build->firstportal[sector] ; i<build->firstportal[sector+1] ; i++)
+    {
+	portal = &build->portals[i];
+	flow->row[portal->to>>3] |= 1 << (portal->to&7);
+
+	flow->online[portal->line] = 1;
+	P_RejectFlow (flow, portal->to, &portal->seg, NULL,
+		      build->mightsee ? build->mightsee + i*build->mightwords : NULL, 1);
+	flow->online[portal->line] = 0;
+    }
+
+    if (flow->steps <= 0)
+    {
+	P_RejectFlood (flow, sector);
+	I_Lock ();
+	build->floods++;
+	I_Unlock ();
+    }
+}
+
+
+//
+// P_RejectThread
+// Every count-th sector, from index.
+//
+static void
+P_RejectThread
+( void*		data,
+  int		index,
+  int		count )
+{
+    rejectbuild_t*	build;
+    rejectflow_t	flow;
+    int			i;
+
+    build = data;
+
+    flow.build = build;
+    flow.online = calloc (numlines, 1);
+    flow.queue = malloc (numsectors*sizeof(*flow.queue));
+    flow.might = NULL;
+    if (build->mightsee)
+	flow.might = malloc ((REJECTDEPTH+1)*build->mightwords*sizeof(uint64_t));
+
+    for (i=index ; i<numsectors ; i+=count)
+    {
+	if (flow.online && flow.queue && (flow.might || !build->mightsee))
+	    P_RejectSource (&flow, i);
+	else
+	    memset (build->visible + i*build->rowbytes, 0xff, build->rowbytes);
+    }
+
+    free (flow.online);
+    free (flow.queue);
+    free (flow.might);
+}
+
+
+//
+// P_MakeReject
+// Fills matrix, as a REJECT lump.
+// Returns the pairs rejected, -1 if out of memory.
+//
+static int P_MakeReject (byte* matrix)
+{
+    rejectbuild_t	build;
+    rejectportal_t*	portal;
+    line_t*		line;
+    int			numportals;
+    int			rejected;
+    int			s1;
+    int			s2;
+    int			pnum;
+    int			i;
+
+    memset (&build, 0, sizeof(build));
+    build.rowbytes = (numsectors+7)/8;
+    build.portals = malloc (2*numlines*sizeof(*build.portals));
+    build.firstportal = calloc (numsectors+1, sizeof(*build.firstportal));
+    build.visible = calloc (numsectors, build.rowbytes);
+
+    if (!build.portals || !build.firstportal || !build.visible)
+    {
+	free (build.portals);
+	free (build.firstportal);
+	free (build.visible);
+	return -1;
+    }
+
+    // the two sided lines, grouped by near sector,
+    //  a line with the same sector on both sides
+    //  does not lead anywhere
+    for (line=lines, i=0 ; i<numlines ; line++, i++)
+    {
+	if ((line->flags & ML_TWOSIDED) && line->backsector
+	    && line->backsector != line->frontsector)
+	{
+	    build.firstportal[line->frontsector-sectors]++;
+	    build.firstportal[line->backsector-sectors]++;
+	}
+    }
+
+    for (i=0, numportals=0 ; i<=numsectors ; i++)
+    {
+	numportals += build.firstportal[i];
+	build.firstportal[i] = numportals;
+    }
+
+    for (line=lines+numlines-1, i=numlines-1 ; i>=0 ; line--, i--)
+    {
+	if (!(line->flags & ML_TWOSIDED) || !line->backsector
+	    || line->backsector == line->frontsector)
+	    continue;
+
+	// back side on the left
+	portal = &build.portals[--build.firstportal[line->frontsector-sectors]];
+	portal->seg.x1 = (double)line->v1->x / FRACUNIT;
+	portal->seg.y1 = (double)line->v1->y / FRACUNIT;
+	portal->seg.x2 = (double)line->v2->x / FRACUNIT;
+	portal->seg.y2 = (double)line->v2->y / FRACUNIT;
+	portal->line = i;
+	portal->to = line->backsector - sectors;
+
+	portal = &build.portals[--build.firstportal[line->backsector-sectors]];
+	portal->seg.x1 = (double)line->v2->x / FRACUNIT;
+	portal->seg.y1 = (double)line->v2->y / FRACUNIT;
+	portal->seg.x2 = (double)line->v1->x / FRACUNIT;
+	portal->seg.y2 = (double)line->v1->y / FRACUNIT;
+	portal->line = i;
+	portal->to = line->frontsector - sectors;
+    }
+
+    build.numportals = numportals;
+    if (numportals <= REJECTMIGHT)
+    {
+	build.mightwords = (numportals+63)/64;
+	build.mightsee = calloc (numportals, build.mightwords*sizeof(uint64_t));
+	if (build.mightsee)
+	    I_RunThreads (P_RejectMightSee, &build);
+    }
+
+    I_RunThreads (P_RejectThread, &build);
+
+    // rejected both ways, the sight checks are not
+    //  always made from the same side
+    memset (matrix, 0, (numsectors*numsectors+7)/8);
+    rejected = 0;
+    for (s1=0 ; s1<numsectors ; s1++)
+    {
+	for (s2=0 ; s2<numsectors ; s2++)
+	{
+	    if (build.visible[s1*build.rowbytes + (s2>>3)] & (1 << (s2&7)))
+		continue;
+	    if (build.visible[s2*build.rowbytes + (s1>>3)] & (1 << (s1&7)))
+		continue;
+	    pnum = s1*numsectors + s2;
+	    matrix[pnum>>3] |= 1 << (pnum&7);
+	    rejected++;
+	}
+    }
+
+    if (build.floods)
+	I_Debug ("P_MakeReject: %i sectors out of steps, flooded", build.floods);
+
+    free (build.portals);
+    free (build.firstportal);
+    free (build.visible);
+    free (build.mightsee);
+    return rejected;
+}
+
+
+//
+// P_BuildReject
+//
+void
+P_BuildReject
+( int		lumpnum,
+  char*		lumpname )
+{
+    byte*	matrix;
+    int		size;
+    int		length;
+    int		rejected;
+    int		hidden;
+    int		missed;
+    boolean	empty;
+    int64_t	start;
+    int		i;
+    int		j;
+
+    size = (numsectors*numsectors+7)/8;
+    matrix = malloc (size);
+    if (!matrix)
+	return;
+
+    if (!P_ReadRejectCache (lumpnum, lumpname, matrix, size))
+    {
+	start = I_GetTimeNS ();
+	rejected = P_MakeReject (matrix);
+	if (rejected < 0)
+	{
+	    free (matrix);
+	    return;
+	}
+	I_Debug ("P_BuildReject: %s, %i of %i sector pairs rejected in %i ms",
+		 lumpname, rejected, numsectors*numsectors,
+		 (int)((I_GetTimeNS () - start) / 1000000));
+	P_WriteRejectCache (lumpnum, lumpname, matrix, size);
+    }
+
+    // a short or blank lump rejects nothing
+    length = W_LumpLength (lumpnum+ML_REJECT);
+    empty = (length < size);
+    for (i=0 ; i<size && !empty ; i++)
+	if (rejectmatrix[i])
+	    break;
+    if (i == size)
+	empty = true;
+
+    if (empty)
+    {
+	rejectmatrix = Z_Malloc (size, PU_LEVEL, 0);
+	memcpy (rejectmatrix, matrix, size);
+	I_Debug ("P_BuildReject: %s, REJECT lump replaced", lumpname);
+	free (matrix);
+	return;
+    }
+
+    // the lump is kept, as the demos were recorded with it
+    hidden = missed = 0;
+    for (i=0 ; i<size ; i++)
+    {
+	for (j=0 ; j<8 ; j++)
+	{
+	    if ((rejectmatrix[i] & ~matrix[i]) & (1 << j))
+		hidden++;
+	    if ((matrix[i] & ~rejectmatrix[i]) & (1 << j))
+		missed++;
+	}
+    }
+
+    if (hidden)
+	I_Alert ("P_BuildReject: %s, REJECT lump rejects %i sector pairs that may see each other",
+		 lumpname, hidden);
+    if (missed)
+	I_Debug ("P_BuildReject: %s, REJECT lump misses %i sector pairs out of sight",
+		 lumpname, missed);
+
+    free (matrix);
+}
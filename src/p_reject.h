@@ -0,0 +1,44 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	REJECT table builder.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __P_REJECT__
+#define __P_REJECT__
+
+
+#ifdef __GNUG__
+#pragma interface
+#endif
+
+
+// Builds the REJECT table of the map just loaded from
+//  its two sided lines, or loads it from the -levelcache
+//  directory. It replaces a short or blank REJECT lump,
+//  a shipped one is only checked against it.
+void P_BuildReject (int lumpnum, char* lumpname);
+
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
@@ -21,6 +21,8 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stddef.h>
+
 #include "i_system.h"
 #include "z_zone.h"
 #include "p_local.h"
@@ -37,6 +39,40 @@ byte*		save_p;
 #define PADSAVEP()	save_p += (4 - ((long) save_p & 3)) & 3
 
 
+// The thinkers are saved without their links in
+//  the lists by type, as before these were added,
+//  P_AddThinker links them again on load.
+#define SAVETHINKERSIZE	offsetof(thinker_t, cprev)
+#define SAVELINKSIZE	(sizeof(thinker_t) - SAVETHINKERSIZE)
+
+//
+// P_WriteThinker
+// Saves a thinker, size bytes long,
+//  without its links.
+//
+static void P_WriteThinker (void* th, int size)
+{
+    memcpy (save_p, th, SAVETHINKERSIZE);
+    memcpy (save_p + SAVETHINKERSIZE,
+	    (byte *)th + sizeof(thinker_t),
+	    size - sizeof(thinker_t));
+    save_p += size - SAVELINKSIZE;
+}
+
+//
+// P_ReadThinker
+// Loads a thinker saved by P_WriteThinker.
+//
+static void P_ReadThinker (void* th, int size)
+{
+    memcpy (th, save_p, SAVETHINKERSIZE);
+    memcpy ((byte *)th + sizeof(thinker_t),
+	    save_p + SAVETHINKERSIZE,
+	    size - sizeof(thinker_t));
+    save_p += size - SAVELINKSIZE;
+}
+
+
 
 //
 // P_ArchivePlayers
@@ -171,6 +207,7 @@ void P_UnArchiveWorld (void)
     short*		get;
 	
     get = (short *)save_p;
+    sectorepoch++;
     
     // do sectors
     for (i=0, sec = sectors ; i<numsectors ; i++,sec++)
@@ -229,22 +266,21 @@ typedef enum
 void P_ArchiveThinkers (void)
 {
     thinker_t*		th;
-    mobj_t*		mobj;
+    mobj_t		mobj;
 	
-    // save off the current thinkers
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    // save off the current things
+    for (th = thinkercaps[th_mobj].cnext ; th != &thinkercaps[th_mobj] ; th=th->cnext)
     {
 	if (th->function.acp1 == (actionf_p1)P_MobjThinker)
 	{
 	    *save_p++ = tc_mobj;
 	    PADSAVEP();
-	    mobj = (mobj_t *)save_p;
-	    memcpy (mobj, th, sizeof(*mobj));
-	    save_p += sizeof(*mobj);
-	    mobj->state = (state_t *)(mobj->state - states);
+	    memcpy (&mobj, th, sizeof(mobj));
+	    mobj.state = (state_t *)(mobj.state - states);
 	    
-	    if (mobj->player)
-		mobj->player = (player_t *)((mobj->player-players) + 1);
+	    if (mobj.player)
+		mobj.player = (player_t *)((mobj.player-players) + 1);
+	    P_WriteThinker (&mobj, sizeof(mobj));
 	    continue;
 	}
 		
@@ -294,8 +330,7 @@ void P_UnArchiveThinkers (void)
 	  case tc_mobj:
 	    PADSAVEP();
 	    mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
-	    memcpy (mobj, save_p, sizeof(*mobj));
-	    save_p += sizeof(*mobj);
+	    P_ReadThinker (mobj, sizeof(*mobj));
 	    mobj->state = &states[(long)mobj->state];
 	    mobj->target = NULL;
 	    if (mobj->player)
@@ -308,7 +343,7 @@ void P_UnArchiveThinkers (void)
 	    mobj->floorz = mobj->subsector->sector->floorheight;
 	    mobj->ceilingz = mobj->subsector->sector->ceilingheight;
 	    mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
-	    P_AddThinker (&mobj->thinker);
+	    P_AddThinker (&mobj->thinker, th_mobj);
 	    break;
 			
 	  default:
@@ -352,13 +387,13 @@ enum
 void P_ArchiveSpecials (void)
 {
     thinker_t*		th;
-    ceiling_t*		ceiling;
-    vldoor_t*		door;
-    floormove_t*	floor;
-    plat_t*		plat;
-    lightflash_t*	flash;
-    strobe_t*		strobe;
-    glow_t*		glow;
+    ceiling_t		ceiling;
+    vldoor_t		door;
+    floormove_t		floor;
+    plat_t		plat;
+    lightflash_t	flash;
+    strobe_t		strobe;
+    glow_t		glow;
     int			i;
 	
     // save off the current thinkers
@@ -374,10 +409,9 @@ void P_ArchiveSpecials (void)
 	    {
 		*save_p++ = tc_ceiling;
 		PADSAVEP();
-		ceiling = (ceiling_t *)save_p;
-		memcpy (ceiling, th, sizeof(*ceiling));
-		save_p += sizeof(*ceiling);
-		ceiling->sector = (sector_t *)(ceiling->sector - sectors);
+		memcpy (&ceiling, th, sizeof(ceiling));
+		ceiling.sector = (sector_t *)(ceiling.sector - sectors);
+		P_WriteThinker (&ceiling, sizeof(ceiling));
 	    }
 	    continue;
 	}
@@ -386,10 +420,9 @@ void P_ArchiveSpecials (void)
 	{
 	    *save_p++ = tc_ceiling;
 	    PADSAVEP();
-	    ceiling = (ceiling_t *)save_p;
-	    memcpy (ceiling, th, sizeof(*ceiling));
-	    save_p += sizeof(*ceiling);
-	    ceiling->sector = (sector_t *)(ceiling->sector - sectors);
+	    memcpy (&ceiling, th, sizeof(ceiling));
+	    ceiling.sector = (sector_t *)(ceiling.sector - sectors);
+	    P_WriteThinker (&ceiling, sizeof(ceiling));
 	    continue;
 	}
 			
@@ -397,10 +430,9 @@ void P_ArchiveSpecials (void)
 	{
 	    *save_p++ = tc_door;
 	    PADSAVEP();
-	    door = (vldoor_t *)save_p;
-	    memcpy (door, th, sizeof(*door));
-	    save_p += sizeof(*door);
-	    door->sector = (sector_t *)(door->sector - sectors);
+	    memcpy (&door, th, sizeof(door));
+	    door.sector = (sector_t *)(door.sector - sectors);
+	    P_WriteThinker (&door, sizeof(door));
 	    continue;
 	}
 			
@@ -408,10 +440,9 @@ void P_ArchiveSpecials (void)
 	{
 	    *save_p++ = tc_floor;
 	    PADSAVEP();
-	    floor = (floormove_t *)save_p;
-	    memcpy (floor, th, sizeof(*floor));
-	    save_p += sizeof(*floor);
-	    floor->sector = (sector_t *)(floor->sector - sectors);
+	    memcpy (&floor, th, sizeof(floor));
+	    floor.sector = (sector_t *)(floor.sector - sectors);
+	    P_WriteThinker (&floor, sizeof(floor));
 	    continue;
 	}
 			
@@ -419,10 +450,9 @@ void P_ArchiveSpecials (void)
 	{
 	    *save_p++ = tc_plat;
 	    PADSAVEP();
-	    plat = (plat_t *)save_p;
-	    memcpy (plat, th, sizeof(*plat));
-	    save_p += sizeof(*plat);
-	    plat->sector = (sector_t *)(plat->sector - sectors);
+	    memcpy (&plat, th, sizeof(plat));
+	    plat.sector = (sector_t *)(plat.sector - sectors);
+	    P_WriteThinker (&plat, sizeof(plat));
 	    continue;
 	}
 			
@@ -430,10 +460,9 @@ void P_ArchiveSpecials (void)
 	{
 	    *save_p++ = tc_flash;
 	    PADSAVEP();
-	    flash = (lightflash_t *)save_p;
-	    memcpy (flash, th, sizeof(*flash));
-	    save_p += sizeof(*flash);
-	    flash->sector = (sector_t *)(flash->sector - sectors);
+	    memcpy (&flash, th, sizeof(flash));
+	    flash.sector = (sector_t *)(flash.sector - sectors);
+	    P_WriteThinker (&flash, sizeof(flash));
 	    continue;
 	}
 			
@@ -441,10 +470,9 @@ void P_ArchiveSpecials (void)
 	{
 	    *save_p++ = tc_strobe;
 	    PADSAVEP();
-	    strobe = (strobe_t *)save_p;
-	    memcpy (strobe, th, sizeof(*strobe));
-	    save_p += sizeof(*strobe);
-	    strobe->sector = (sector_t *)(strobe->sector - sectors);
+	    memcpy (&strobe, th, sizeof(strobe));
+	    strobe.sector = (sector_t *)(strobe.sector - sectors);
+	    P_WriteThinker (&strobe, sizeof(strobe));
 	    continue;
 	}
 			
@@ -452,10 +480,9 @@ void P_ArchiveSpecials (void)
 	{
 	    *save_p++ = tc_glow;
 	    PADSAVEP();
-	    glow = (glow_t *)save_p;
-	    memcpy (glow, th, sizeof(*glow));
-	    save_p += sizeof(*glow);
-	    glow->sector = (sector_t *)(glow->sector - sectors);
+	    memcpy (&glow, th, sizeof(glow));
+	    glow.sector = (sector_t *)(glow.sector - sectors);
+	    P_WriteThinker (&glow, sizeof(glow));
 	    continue;
 	}
     }
@@ -493,83 +520,76 @@ void P_UnArchiveSpecials (void)
 	  case tc_ceiling:
 	    PADSAVEP();
 	    ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVEL, NULL);
-	    memcpy (ceiling, save_p, sizeof(*ceiling));
-	    save_p += sizeof(*ceiling);
+	    P_ReadThinker (ceiling, sizeof(*ceiling));
 	    ceiling->sector = &sectors[(long)ceiling->sector];
 	    ceiling->sector->specialdata = ceiling;
 
 	    if (ceiling->thinker.function.acp1)
 		ceiling->thinker.function.acp1 = (actionf_p1)T_MoveCeiling;
 
-	    P_AddThinker (&ceiling->thinker);
+	    P_AddThinker (&ceiling->thinker, th_mover);
 	    P_AddActiveCeiling(ceiling);
 	    break;
 				
 	  case tc_door:
 	    PADSAVEP();
 	    door = Z_Malloc (sizeof(*door), PU_LEVEL, NULL);
-	    memcpy (door, save_p, sizeof(*door));
-	    save_p += sizeof(*door);
+	    P_ReadThinker (door, sizeof(*door));
 	    door->sector = &sectors[(long)door->sector];
 	    door->sector->specialdata = door;
 	    door->thinker.function.acp1 = (actionf_p1)T_VerticalDoor;
-	    P_AddThinker (&door->thinker);
+	    P_AddThinker (&door->thinker, th_mover);
 	    break;
 				
 	  case tc_floor:
 	    PADSAVEP();
 	    floor = Z_Malloc (sizeof(*floor), PU_LEVEL, NULL);
-	    memcpy (floor, save_p, sizeof(*floor));
-	    save_p += sizeof(*floor);
+	    P_ReadThinker (floor, sizeof(*floor));
 	    floor->sector = &sectors[(long)floor->sector];
 	    floor->sector->specialdata = floor;
 	    floor->thinker.function.acp1 = (actionf_p1)T_MoveFloor;
-	    P_AddThinker (&floor->thinker);
+	    P_AddThinker (&floor->thinker, th_mover);
 	    break;
 				
 	  case tc_plat:
 	    PADSAVEP();
 	    plat = Z_Malloc (sizeof(*plat), PU_LEVEL, NULL);
-	    memcpy (plat, save_p, sizeof(*plat));
-	    save_p += sizeof(*plat);
+	    P_ReadThinker (plat, sizeof(*plat));
 	    plat->sector = &sectors[(long)plat->sector];
 	    plat->sector->specialdata = plat;
 
 	    if (plat->thinker.function.acp1)
 		plat->thinker.function.acp1 = (actionf_p1)T_PlatRaise;
 
-	    P_AddThinker (&plat->thinker);
+	    P_AddThinker (&plat->thinker, th_mover);
 	    P_AddActivePlat(plat);
 	    break;
 				
 	  case tc_flash:
 	    PADSAVEP();
 	    flash = Z_Malloc (sizeof(*flash), PU_LEVEL, NULL);
-	    memcpy (flash, save_p, sizeof(*flash));
-	    save_p += sizeof(*flash);
+	    P_ReadThinker (flash, sizeof(*flash));
 	    flash->sector = &sectors[(long)flash->sector];
 	    flash->thinker.function.acp1 = (actionf_p1)T_LightFlash;
-	    P_AddThinker (&flash->thinker);
+	    P_AddThinker (&flash->thinker, th_light);
 	    break;
 				
 	  case tc_strobe:
 	    PADSAVEP();
 	    strobe = Z_Malloc (sizeof(*strobe), PU_LEVEL, NULL);
-	    memcpy (strobe, save_p, sizeof(*strobe));
-	    save_p += sizeof(*strobe);
+	    P_ReadThinker (strobe, sizeof(*strobe));
 	    strobe->sector = &sectors[(long)strobe->sector];
 	    strobe->thinker.function.acp1 = (actionf_p1)T_StrobeFlash;
-	    P_AddThinker (&strobe->thinker);
+	    P_AddThinker (&strobe->thinker, th_light);
 	    break;
 				
 	  case tc_glow:
 	    PADSAVEP();
 	    glow = Z_Malloc (sizeof(*glow), PU_LEVEL, NULL);
-	    memcpy (glow, save_p, sizeof(*glow));
-	    save_p += sizeof(*glow);
+	    P_ReadThinker (glow, sizeof(*glow));
 	    glow->sector = &sectors[(long)glow->sector];
 	    glow->thinker.function.acp1 = (actionf_p1)T_Glow;
-	    P_AddThinker (&glow->thinker);
+	    P_AddThinker (&glow->thinker, th_light);
 	    break;
 				
 	  default:
@@ -23,11 +23,14 @@
 //-----------------------------------------------------------------------------
 
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "z_zone.h"
 
 #include "m_swap.h"
 #include "m_bbox.h"
+#include "m_misc.h"
 
 #include "g_game.h"
 
@@ -36,6 +39,8 @@
 
 #include "doomdef.h"
 #include "p_local.h"
+#include "p_cache.h"
+#include "p_reject.h"
 
 #include "s_sound.h"
 
@@ -81,9 +86,10 @@ side_t*		sides;
 // Blockmap size.
 int		bmapwidth;
 int		bmapheight;	// size in mapblocks
-short*		blockmap;	// int for larger maps
+int*		blockmap;	// int for larger maps
 // offsets in blockmap are from here
-short*		blockmaplump;		
+int*		blockmaplump;		
+int		blockmaplength;
 // origin of block map
 fixed_t		bmaporgx;
 fixed_t		bmaporgy;
@@ -299,6 +305,7 @@ void P_LoadThings (int lump)
     byte*		data;
     int			i;
     mapthing_t*		mt;
+    mapthing_t		spawnthing;
     int			numthings;
     boolean		spawn;
 	
@@ -333,13 +340,14 @@ void P_LoadThings (int lump)
 	    break;
 
 	// Do spawn all other stuff. 
-	mt->x = SHORT(mt->x);
-	mt->y = SHORT(mt->y);
-	mt->angle = SHORT(mt->angle);
-	mt->type = SHORT(mt->type);
-	mt->options = SHORT(mt->options);
+	// The lump can be mapped read only.
+	spawnthing.x = SHORT(mt->x);
+	spawnthing.y = SHORT(mt->y);
+	spawnthing.angle = SHORT(mt->angle);
+	spawnthing.type = SHORT(mt->type);
+	spawnthing.options = SHORT(mt->options);
 	
-	P_SpawnMapThing (mt);
+	P_SpawnMapThing (&spawnthing);
     }
 	
     Z_Free (data);
@@ -459,25 +467,344 @@ void P_LoadSideDefs (int lump)
 }
 
 
+//
+// BLOCKMAP LISTS
+// The line lists of all the blocks, one after the
+//  other, each ended by -1. Blocks with the same lines
+//  share one list, found by a hash of its contents.
+//
+static int*	newlists;
+static int	numnewlists;
+static int	maxnewlists;
+static int*	listhash;
+static int	listhashmask;
+
+
+//
+// P_InitBlockLists
+//
+static void P_InitBlockLists (int numblocks)
+{
+    int		i;
+
+    for (listhashmask=1 ; listhashmask < numblocks*2 ; listhashmask <<= 1)
+	;
+    listhash = malloc (listhashmask*sizeof(*listhash));
+    if (!listhash)
+	I_Error ("P_InitBlockLists: out of memory");
+    for (i=0 ; i<listhashmask ; i++)
+	listhash[i] = -1;
+    listhashmask--;
+
+    newlists = NULL;
+    numnewlists = maxnewlists = 0;
+}
+
+
+//
+// P_AddBlockList
+// Returns the offset of the list ended by -1,
+//  added unless an earlier block has the same.
+//
+static int
+P_AddBlockList
+( int*		list,
+  int		count )
+{
+    int		slot;
+    int		offset;
+    int		i;
+
+    slot = M_HashBytes (M_HASHSEED, list, count*sizeof(*list)) & listhashmask;
+    for ( ; (offset = listhash[slot]) != -1 ; slot = (slot+1) & listhashmask)
+    {
+	// a shorter or longer list differs before its -1
+	for (i=0 ; i<count && newlists[offset+i] == list[i] ; i++)
+	    ;
+	if (i == count)
+	    return offset;
+    }
+
+    if (numnewlists + count > maxnewlists)
+    {
+	maxnewlists = maxnewlists*2 + count;
+	newlists = realloc (newlists, maxnewlists*sizeof(*newlists));
+	if (!newlists)
+	    I_Error ("P_AddBlockList: out of memory");
+    }
+
+    offset = numnewlists;
+    memcpy (newlists+offset, list, count*sizeof(*list));
+    numnewlists += count;
+    listhash[slot] = offset;
+    return offset;
+}
+
+
+//
+// P_FreeBlockLists
+//
+static void P_FreeBlockLists (void)
+{
+    free (newlists);
+    free (listhash);
+    newlists = NULL;
+    listhash = NULL;
+}
+
+
+//
+// P_FinishBlockLists
+// Moves the lists into the level.
+//
+static void P_FinishBlockLists (void)
+{
+    blockmaplength = numnewlists;
+    blockmaplump = Z_Malloc (numnewlists*sizeof(*blockmaplump), PU_LEVEL, 0);
+    memcpy (blockmaplump, newlists, numnewlists*sizeof(*blockmaplump));
+    P_FreeBlockLists ();
+}
+
+
+//
+// P_ConvertBlockMap
+// Offsets and line numbers read as unsigned shorts,
+//  the lists kept as they are, in the same order.
+// Returns false if the lump is broken.
+//
+static boolean
+P_ConvertBlockMap
+( short*	data,
+  int		count )
+{
+    int*	list;
+    int		numblocks;
+    int		offset;
+    int		line;
+    int		n;
+    int		i;
+    int		b;
+
+    bmaporgx = SHORT(data[0])<<FRACBITS;
+    bmaporgy = SHORT(data[1])<<FRACBITS;
+    bmapwidth = SHORT(data[2]);
+    bmapheight = SHORT(data[3]);
+
+    numblocks = bmapwidth*bmapheight;
+    if (bmapwidth <= 0 || bmapheight <= 0 || 4+numblocks > count)
+	return false;
+
+    list = malloc ((count+1)*sizeof(*list));
+    if (!list)
+	I_Error ("P_ConvertBlockMap: out of memory");
+
+    blockmap = Z_Malloc (numblocks*sizeof(*blockmap), PU_LEVEL, 0);
+    P_InitBlockLists (numblocks);
+
+    for (b=0 ; b<numblocks ; b++)
+    {
+	offset = (unsigned short)SHORT(data[4+b]);
+
+	n = 0;
+	for (i=offset ; i<count ; i++)
+	{
+	    line = (unsigned short)SHORT(data[i]);
+	    if (line == 0xffff || line >= numlines)
+		break;
+	    list[n++] = line;
+	}
+	if (i == count || line != 0xffff)
+	{
+	    free (list);
+	    P_FreeBlockLists ();
+	    Z_Free (blockmap);
+	    return false;
+	}
+	list[n++] = -1;
+
+	blockmap[b] = P_AddBlockList (list, n);
+    }
+
+    free (list);
+    P_FinishBlockLists ();
+    return true;
+}
+
+
+//
+// P_CreateBlockMap
+// Each line goes in the blocks it touches, borders
+//  included. The lists start with line 0 as in the
+//  lumps of the node builders.
+//
+static void P_CreateBlockMap (void)
+{
+    int*	first;		// numblocks+1 entries
+    int*	cells;
+    int*	list;
+    line_t*	ld;
+    int64_t	x1, y1, x2, y2;
+    int64_t	bx, by;
+    int64_t	s[4];
+    int		minx, miny;
+    int		maxx, maxy;
+    int		xl, xh;
+    int		yl, yh;
+    int		numblocks;
+    int		pass;
+    int		n;
+    int		i;
+    int		b;
+    int		x;
+    int		y;
+
+    minx = miny = maxx = maxy = 0;
+    for (i=0 ; i<numvertexes ; i++)
+    {
+	x = vertexes[i].x>>FRACBITS;
+	y = vertexes[i].y>>FRACBITS;
+	if (!i || x < minx)
+	    minx = x;
+	if (!i || y < miny)
+	    miny = y;
+	if (!i || x > maxx)
+	    maxx = x;
+	if (!i || y > maxy)
+	    maxy = y;
+    }
+
+    // a margin, as the node builders leave
+    minx -= 8;
+    miny -= 8;
+    bmaporgx = minx<<FRACBITS;
+    bmaporgy = miny<<FRACBITS;
+    bmapwidth = (maxx-minx)/MAPBLOCKUNITS + 1;
+    bmapheight = (maxy-miny)/MAPBLOCKUNITS + 1;
+    numblocks = bmapwidth*bmapheight;
+
+    first = calloc (numblocks+1, sizeof(*first));
+    if (!first)
+	I_Error ("P_CreateBlockMap: out of memory");
+    cells = NULL;
+
+    // count, then fill
+    for (pass=0 ; pass<2 ; pass++)
+    {
+	for (i=0, ld=lines ; i<numlines ; i++, ld++)
+	{
+	    x1 = (ld->v1->x>>FRACBITS) - minx;
+	    y1 = (ld->v1->y>>FRACBITS) - miny;
+	    x2 = (ld->v2->x>>FRACBITS) - minx;
+	    y2 = (ld->v2->y>>FRACBITS) - miny;
+
+	    // the blocks of its bounding box, and those
+	    //  sharing a border with them
+	    xl = ((x1 < x2 ? x1 : x2) - 1)/MAPBLOCKUNITS;
+	    xh = ((x1 < x2 ? x2 : x1) + 1)/MAPBLOCKUNITS;
+	    yl = ((y1 < y2 ? y1 : y2) - 1)/MAPBLOCKUNITS;
+	    yh = ((y1 < y2 ? y2 : y1) + 1)/MAPBLOCKUNITS;
+	    if (xh >= bmapwidth)
+		xh = bmapwidth-1;
+	    if (yh >= bmapheight)
+		yh = bmapheight-1;
+
+	    for (y=yl ; y<=yh ; y++)
+	    {
+		for (x=xl ; x<=xh ; x++)
+		{
+		    // the corners of the block not all on one side
+		    bx = x*MAPBLOCKUNITS;
+		    by = y*MAPBLOCKUNITS;
+		    s[0] = (x2-x1)*(by-y1) - (y2-y1)*(bx-x1);
+		    s[1] = (x2-x1)*(by-y1) - (y2-y1)*(bx+MAPBLOCKUNITS-x1);
+		    s[2] = (x2-x1)*(by+MAPBLOCKUNITS-y1) - (y2-y1)*(bx-x1);
+		    s[3] = (x2-x1)*(by+MAPBLOCKUNITS-y1) - (y2-y1)*(bx+MAPBLOCKUNITS-x1);
+		    if ((s[0] > 0 && s[1] > 0 && s[2] > 0 && s[3] > 0)
+			|| (s[0] < 0 && s[1] < 0 && s[2] < 0 && s[3] < 0))
+			continue;
+
+		    b = y*bmapwidth+x;
+		    if (pass == 0)
+			first[b+1]++;
+		    else
+			cells[first[b]++] = i;
+		}
+	    }
+	}
+
+	if (pass == 0)
+	{
+	    for (b=0 ; b<numblocks ; b++)
+		first[b+1] += first[b];
+	    cells = malloc ((first[numblocks]+1)*sizeof(*cells));
+	    if (!cells)
+		I_Error ("P_CreateBlockMap: out of memory");
+	}
+    }
+
+    // filling moved every first to the next one
+    for (b=numblocks ; b>0 ; b--)
+	first[b] = first[b-1];
+    first[0] = 0;
+
+    n = 0;
+    for (b=0 ; b<numblocks ; b++)
+	if (first[b+1]-first[b] > n)
+	    n = first[b+1]-first[b];
+    list = malloc ((n+2)*sizeof(*list));
+    if (!list)
+	I_Error ("P_CreateBlockMap: out of memory");
+
+    blockmap = Z_Malloc (numblocks*sizeof(*blockmap), PU_LEVEL, 0);
+    P_InitBlockLists (numblocks);
+
+    for (b=0 ; b<numblocks ; b++)
+    {
+	n = 0;
+	list[n++] = 0;
+	for (i=first[b] ; i<first[b+1] ; i++)
+	    list[n++] = cells[i];
+	list[n++] = -1;
+	blockmap[b] = P_AddBlockList (list, n);
+    }
+
+    P_FinishBlockLists ();
+
+    free (list);
+    free (cells);
+    free (first);
+}
+
+
 //
 // P_LoadBlockMap
+// The lump is read into 32 bit offsets and line
+//  numbers, the lists in the same order so that the
+//  demos play the same. The blockmap is built from the
+//  lines instead with -buildblockmap, or when the lump
+//  is missing, broken, or too long for 16 bit offsets.
 //
 void P_LoadBlockMap (int lump)
 {
-    int		i;
+    short*	data;
     int		count;
-	
-    blockmaplump = W_CacheLumpNum (lump,PU_LEVEL);
-    blockmap = blockmaplump+4;
+    boolean	loaded;
+
+    loaded = false;
     count = W_LumpLength (lump)/2;
+    if (!g_buildblockmap && count >= 4 && count <= 0x10000)
+    {
+	data = W_CacheLumpNum (lump, PU_STATIC);
+	loaded = P_ConvertBlockMap (data, count);
+	Z_Free (data);
+    }
 
-    for (i=0 ; i<count ; i++)
-	blockmaplump[i] = SHORT(blockmaplump[i]);
-		
-    bmaporgx = blockmaplump[0]<<FRACBITS;
-    bmaporgy = blockmaplump[1]<<FRACBITS;
-    bmapwidth = blockmaplump[2];
-    bmapheight = blockmaplump[3];
+    if (!loaded)
+    {
+	P_CreateBlockMap ();
+	I_Debug ("P_LoadBlockMap: %ix%i blocks built from the lines",
+		 bmapwidth, bmapheight);
+    }
 	
     // clear out mobj chains
     count = sizeof(*blocklinks)* bmapwidth*bmapheight;
@@ -573,6 +900,125 @@ void P_GroupLines (void)
 }
 
 
+//
+// With -arenafit, the level arena is sized
+//  from the previous load of the same map.
+//
+static int*	arenasizes;	// by map lump
+static int	arenalump = -1;
+
+
+//
+// P_MapName
+//
+static void
+P_MapName
+( int		episode,
+  int		map,
+  char*		lumpname )
+{
+    if ( gamemode == commercial)
+    {
+	if (map<10)
+	    sprintf (lumpname,"map0%i", map);
+	else
+	    sprintf (lumpname,"map%i", map);
+    }
+    else
+    {
+	lumpname[0] = 'E';
+	lumpname[1] = '0' + episode;
+	lumpname[2] = 'M';
+	lumpname[3] = '0' + map;
+	lumpname[4] = 0;
+    }
+}
+
+
+//
+// P_PrefetchTask
+// Reads ahead the map lumps, then the patches of
+//  the wall textures, the flats and the sprites
+//  of the things they use. It runs in the background,
+//  with nothing but the lumps and the static tables.
+//
+static void P_PrefetchThing (int type)
+{
+    int		i;
+
+    for (i=0 ; i<NUMMOBJTYPES ; i++)
+    {
+	if (mobjinfo[i].doomednum == type)
+	{
+	    R_PrefetchSprite (states[mobjinfo[i].spawnstate].sprite);
+	    return;
+	}
+    }
+}
+
+static void P_PrefetchTask (void* data)
+{
+    mapsidedef_t*	msd;
+    mapsector_t*	ms;
+    mapthing_t*		mt;
+    int			prefetchlump;
+    int			count;
+    int			i;
+
+    prefetchlump = (int)(intptr_t)data;
+
+    for (i=ML_THINGS ; i<=ML_BLOCKMAP ; i++)
+	W_PrefetchLump (prefetchlump+i);
+
+    msd = W_PrefetchData (prefetchlump+ML_SIDEDEFS);
+    count = msd ? W_LumpLength (prefetchlump+ML_SIDEDEFS) / sizeof(mapsidedef_t) : 0;
+    for (i=0 ; i<count ; i++, msd++)
+    {
+	R_PrefetchTexture (msd->toptexture);
+	R_PrefetchTexture (msd->bottomtexture);
+	R_PrefetchTexture (msd->midtexture);
+    }
+
+    ms = W_PrefetchData (prefetchlump+ML_SECTORS);
+    count = ms ? W_LumpLength (prefetchlump+ML_SECTORS) / sizeof(mapsector_t) : 0;
+    for (i=0 ; i<count ; i++, ms++)
+    {
+	W_PrefetchLump (W_CheckNumForNameNS (ms->floorpic, ns_flats));
+	W_PrefetchLump (W_CheckNumForNameNS (ms->ceilingpic, ns_flats));
+    }
+
+    mt = W_PrefetchData (prefetchlump+ML_THINGS);
+    count = mt ? W_LumpLength (prefetchlump+ML_THINGS) / sizeof(mapthing_t) : 0;
+    for (i=0 ; i<count ; i++, mt++)
+	P_PrefetchThing (SHORT(mt->type));
+}
+
+
+//
+// P_PrefetchLevel
+// Called when the intermission starts.
+//
+void
+P_PrefetchLevel
+( int		episode,
+  int		map )
+{
+    char	lumpname[16];
+    int		lumpnum;
+
+    if (!g_prefetch)
+	return;
+
+    P_MapName (episode, map, lumpname);
+    lumpnum = W_CheckNumForName (lumpname);
+    if (lumpnum == -1)
+	return;
+
+    W_StartPrefetch (P_PrefetchTask, (void *)(intptr_t)lumpnum);
+}
+
+
+
 //
 // P_SetupLevel
 //
@@ -599,9 +1045,15 @@ P_SetupLevel
     // will be set by player think.
     players[consoleplayer].viewz = 1; 
 
+    // no sight check holds on a new map
+    sectorepoch++;
+
     // Make sure all sounds are stopped before Z_FreeTags.
     S_Start ();			
 
+    // the lumps read ahead during the intermission
+    W_FinishPrefetch ();
+
     
 #if 0 // UNUSED
     if (debugfile)
@@ -611,49 +1063,59 @@ P_SetupLevel
     }
     else
 #endif
+    {
+	// remember what the level being left used
+	if (g_arenafit && arenalump >= 0)
+	    arenasizes[arenalump] = Z_ArenaSize ();
 	Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
+    }
 
 
-    // UNUSED W_Profile ();
     P_InitThinkers ();
 
     // if working with a devlopment map, reload it
     W_Reload ();			
 	   
     // find map name
-    if ( gamemode == commercial)
-    {
-	if (map<10)
-	    sprintf (lumpname,"map0%i", map);
-	else
-	    sprintf (lumpname,"map%i", map);
-    }
-    else
-    {
-	lumpname[0] = 'E';
-	lumpname[1] = '0' + episode;
-	lumpname[2] = 'M';
-	lumpname[3] = '0' + map;
-	lumpname[4] = 0;
-    }
+    P_MapName (episode, map, lumpname);
 
     lumpnum = W_GetNumForName (lumpname);
+
+    if (g_arenafit)
+    {
+	if (!arenasizes)
+	{
+	    arenasizes = Z_Malloc (numlumps*sizeof(*arenasizes), PU_STATIC, 0);
+	    memset (arenasizes, 0, numlumps*sizeof(*arenasizes));
+	}
+	Z_ReserveArena (arenasizes[lumpnum]);
+	arenalump = lumpnum;
+    }
 	
     leveltime = 0;
 	
     // note: most of this ordering is important	
-    P_LoadBlockMap (lumpnum+ML_BLOCKMAP);
-    P_LoadVertexes (lumpnum+ML_VERTEXES);
-    P_LoadSectors (lumpnum+ML_SECTORS);
-    P_LoadSideDefs (lumpnum+ML_SIDEDEFS);
+    if (!P_ReadLevelCache (lumpnum, lumpname))
+    {
+	P_LoadVertexes (lumpnum+ML_VERTEXES);
+	P_LoadSectors (lumpnum+ML_SECTORS);
+	P_LoadSideDefs (lumpnum+ML_SIDEDEFS);
+
+	P_LoadLineDefs (lumpnum+ML_LINEDEFS);
+	P_LoadSubsectors (lumpnum+ML_SSECTORS);
+	P_LoadNodes (lumpnum+ML_NODES);
+	P_LoadSegs (lumpnum+ML_SEGS);
+
+	// built from the lines if need be
+	P_LoadBlockMap (lumpnum+ML_BLOCKMAP);
 
-    P_LoadLineDefs (lumpnum+ML_LINEDEFS);
-    P_LoadSubsectors (lumpnum+ML_SSECTORS);
-    P_LoadNodes (lumpnum+ML_NODES);
-    P_LoadSegs (lumpnum+ML_SEGS);
+	P_GroupLines ();
+	P_WriteLevelCache (lumpnum, lumpname);
+    }
 	
     rejectmatrix = W_CacheLumpNum (lumpnum+ML_REJECT,PU_LEVEL);
-    P_GroupLines ();
+    if (g_buildreject)
+	P_BuildReject (lumpnum, lumpname);
 
     bodyqueslot = 0;
     deathmatch_p = deathmatchstarts;
@@ -684,7 +1146,11 @@ P_SetupLevel
     if (precache)
 	R_PrecacheLevel ();
 
+    // those not taken
+    W_ReleasePrefetch ();
+
     //I_Debug ("free memory: 0x%x", Z_FreeMemory());
+    I_Debug ("P_SetupLevel: %i KB in the level arena", Z_ArenaSize () / 1024);
 
 }
 
@@ -698,6 +1164,17 @@ void P_Init (void)
     P_InitSwitchList ();
     P_InitPicAnims ();
     R_InitSprites (sprnames);
+
+    // the things and specials that come and go
+    Z_InitPool (sizeof(mobj_t));
+    Z_InitPool (sizeof(vldoor_t));
+    Z_InitPool (sizeof(floormove_t));
+    Z_InitPool (sizeof(plat_t));
+    Z_InitPool (sizeof(ceiling_t));
+    Z_InitPool (sizeof(fireflicker_t));
+    Z_InitPool (sizeof(lightflash_t));
+    Z_InitPool (sizeof(strobe_t));
+    Z_InitPool (sizeof(glow_t));
 }
 
 
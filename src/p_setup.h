@@ -40,6 +40,10 @@ P_SetupLevel
 // Called by startup code.
 void P_Init (void);
 
+// Reads ahead the lumps of a level in the background,
+//  P_SetupLevel takes them.
+void P_PrefetchLevel (int episode, int map);
+
 #endif
 //-----------------------------------------------------------------------------
 //
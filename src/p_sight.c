@@ -21,9 +21,12 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stdint.h>
+
 #include "doomdef.h"
 
 #include "i_system.h"
+#include "m_profile.h"
 #include "p_local.h"
 
 // State.
@@ -43,6 +46,29 @@ fixed_t		t2y;
 int		sightcounts[2];
 
 
+//
+// SIGHT CACHE
+// The BSP trace only depends on where the two things
+//  stand and on the floor and ceiling heights, so its
+//  result is kept until either thing moves or until
+//  any plane does, which bumps sectorepoch.
+//
+#define SIGHTCACHESIZE	1024	// must be a power of two
+
+typedef struct
+{
+    fixed_t	x1, y1, z1, height1;
+    fixed_t	x2, y2, z2, height2;
+    int		epoch;
+    boolean	result;
+
+} sightcache_t;
+
+static sightcache_t	sightcache[SIGHTCACHESIZE];
+
+int		sectorepoch;
+
+
 //
 // P_DivlineSide
 // Returns side 0 (front), 1 (back), or 2 (on).
@@ -302,6 +328,8 @@ P_CheckSight
     int		pnum;
     int		bytenum;
     int		bitnum;
+    sightcache_t*	cache;
+    boolean	result;
     
     // First check for trivial rejection.
 
@@ -325,6 +353,24 @@ P_CheckSight
     // Now look from eyes of t1 to any part of t2.
     sightcounts[1]++;
 
+    // Same pair at the same places with no plane moved.
+    cache = NULL;
+    if (g_sightcache)
+    {
+	cache = &sightcache[(((uintptr_t)t1 >> 6) * 31
+			     + ((uintptr_t)t2 >> 6)) & (SIGHTCACHESIZE-1)];
+	if (cache->epoch == sectorepoch
+	    && cache->x1 == t1->x && cache->y1 == t1->y
+	    && cache->z1 == t1->z && cache->height1 == t1->height
+	    && cache->x2 == t2->x && cache->y2 == t2->y
+	    && cache->z2 == t2->z && cache->height2 == t2->height)
+	{
+	    PROF_COUNT (prof_sightcached, 1);
+	    return cache->result;
+	}
+    }
+    PROF_COUNT (prof_sighttraces, 1);
+
     validcount++;
 	
     sightzstart = t1->z + t1->height - (t1->height>>2);
@@ -339,7 +385,23 @@ P_CheckSight
     strace.dy = t2->y - t1->y;
 
     // the head node is the last node output
-    return P_CrossBSPNode (numnodes-1);	
+    result = P_CrossBSPNode (numnodes-1);
+
+    if (cache)
+    {
+	cache->x1 = t1->x;
+	cache->y1 = t1->y;
+	cache->z1 = t1->z;
+	cache->height1 = t1->height;
+	cache->x2 = t2->x;
+	cache->y2 = t2->y;
+	cache->z2 = t2->z;
+	cache->height2 = t2->height;
+	cache->epoch = sectorepoch;
+	cache->result = result;
+    }
+
+    return result;
 }
 
 
@@ -26,6 +26,7 @@
 #include "s_sound.h"
 
 #include "p_local.h"
+#include "p_tick.h"
 
 
 // Data.
@@ -71,10 +72,9 @@ EV_Teleport
     {
 	if (sectors[ i ].tag == tag )
 	{
-	    thinker = thinkercap.next;
-	    for (thinker = thinkercap.next;
-		 thinker != &thinkercap;
-		 thinker = thinker->next)
+	    for (thinker = thinkercaps[th_mobj].cnext;
+		 thinker != &thinkercaps[th_mobj];
+		 thinker = thinker->cnext)
 	    {
 		// not a mobj
 		if (thinker->function.acp1 != (actionf_p1)P_MobjThinker)
@@ -118,6 +118,9 @@ EV_Teleport
 
 		thing->angle = m->angle;
 		thing->momx = thing->momy = thing->momz = 0;
+
+		// no sliding to the destination
+		P_ResetInterpolation (thing);
 		return 1;
 	    }	
 	}
@@ -22,8 +22,13 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stdlib.h>
+
+#include "i_system.h"
 #include "z_zone.h"
 #include "p_local.h"
+#include "p_tick.h"
+#include "m_profile.h"
 
 #include "doomstat.h"
 
@@ -43,13 +48,27 @@ int	leveltime;
 // Both the head and tail of the thinker list.
 thinker_t	thinkercap;
 
+// The thinkers of each type, linked through
+//  cprev and cnext, so that the things can be
+//  gone over without the specials.
+// The thinkers run in the order of the first list:
+//  running the types one after the other would
+//  change the order of the P_Random calls and of
+//  the sector moves, and so the game.
+thinker_t	thinkercaps[NUMTHINKERTYPES];
+
 
 //
 // P_InitThinkers
 //
 void P_InitThinkers (void)
 {
+    int		i;
+
     thinkercap.prev = thinkercap.next  = &thinkercap;
+
+    for (i=0 ; i<NUMTHINKERTYPES ; i++)
+	thinkercaps[i].cprev = thinkercaps[i].cnext = &thinkercaps[i];
 }
 
 
@@ -57,14 +76,23 @@ void P_InitThinkers (void)
 
 //
 // P_AddThinker
-// Adds a new thinker at the end of the list.
+// Adds a new thinker at the end of the list,
+//  and of the list of its type.
 //
-void P_AddThinker (thinker_t* thinker)
+void P_AddThinker (thinker_t* thinker, thinkertype_t type)
 {
+    thinker_t*	cap;
+
     thinkercap.prev->next = thinker;
     thinker->next = &thinkercap;
     thinker->prev = thinkercap.prev;
     thinkercap.prev = thinker;
+
+    cap = &thinkercaps[type];
+    cap->cprev->cnext = thinker;
+    thinker->cnext = cap;
+    thinker->cprev = cap->cprev;
+    cap->cprev = thinker;
 }
 
 
@@ -98,21 +126,37 @@ void P_AllocateThinker (thinker_t*	thinker)
 void P_RunThinkers (void)
 {
     thinker_t*	currentthinker;
+    thinker_t*	nextthinker;
 
     currentthinker = thinkercap.next;
     while (currentthinker != &thinkercap)
     {
 	if ( currentthinker->function.acv == (actionf_v)(-1) )
 	{
-	    // time to remove it
+	    // time to remove it,
+	    //  the zone reuses freed memory
+	    nextthinker = currentthinker->next;
 	    currentthinker->next->prev = currentthinker->prev;
 	    currentthinker->prev->next = currentthinker->next;
+	    currentthinker->cnext->cprev = currentthinker->cprev;
+	    currentthinker->cprev->cnext = currentthinker->cnext;
 	    Z_Free (currentthinker);
+	    currentthinker = nextthinker;
+	    continue;
 	}
 	else
 	{
-	    if (currentthinker->function.acp1)
+	    // most are things, called directly
+	    if (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
+	    {
+		P_MobjThinker ((mobj_t *)currentthinker);
+		PROF_COUNT (prof_thinkerruns, 1);
+	    }
+	    else if (currentthinker->function.acp1)
+	    {
 		currentthinker->function.acp1 (currentthinker);
+		PROF_COUNT (prof_thinkerruns, 1);
+	    }
 	}
 	currentthinker = currentthinker->next;
     }
@@ -120,6 +164,241 @@ void P_RunThinkers (void)
 
 
 
+//
+// Interpolated refresh.
+// With -uncapped, the frames drawn between two tics
+//  lerp the things, the view and the planes from
+//  where they were at the start of the last tic.
+// The positions are kept aside, so the game structs
+//  and the savegames are unchanged. The drawn frame
+//  swaps the lerped values in and puts the game values
+//  back afterwards, the game itself never sees them.
+// Things spawned during the tic are not in the list
+//  and are drawn where they are. Removed things are
+//  only freed by the next P_RunThinkers, after the
+//  next P_StoreInterpolation.
+//
+typedef struct
+{
+    mobj_t*	mobj;
+    fixed_t	x;
+    fixed_t	y;
+    fixed_t	z;
+    angle_t	angle;
+
+} interpmobj_t;
+
+int			interpolationtic = -1;
+
+static interpmobj_t*	interpmobjs;
+static interpmobj_t*	interpsaved;
+static int		numinterpmobjs;
+static int		maxinterpmobjs;
+
+static fixed_t*		interpsectors;
+static fixed_t*		interpsavedsectors;
+static int		maxinterpsectors;
+
+static fixed_t		interpviewz[MAXPLAYERS];
+static fixed_t		interpsavedviewz[MAXPLAYERS];
+
+static boolean		interpolating;
+
+
+//
+// P_StoreInterpolation
+// At the start of each tic, before the thinkers.
+//
+void P_StoreInterpolation (void)
+{
+    thinker_t*	th;
+    mobj_t*	mo;
+    int		count;
+    int		i;
+
+    count = 0;
+    for (th=thinkercaps[th_mobj].cnext ; th != &thinkercaps[th_mobj] ; th=th->cnext)
+	if (th->function.acp1 == (actionf_p1)P_MobjThinker)
+	    count++;
+
+    if (count > maxinterpmobjs)
+    {
+	maxinterpmobjs = count*2;
+	interpmobjs = realloc (interpmobjs, maxinterpmobjs*sizeof(*interpmobjs));
+	interpsaved = realloc (interpsaved, maxinterpmobjs*sizeof(*interpsaved));
+	
+	if (!interpmobjs || !interpsaved)
+	    I_Error ("P_StoreInterpolation: couldn't allocate %i things",
+		     maxinterpmobjs);
+    }
+
+    if (numsectors > maxinterpsectors)
+    {
+	maxinterpsectors = numsectors;
+	interpsectors = realloc (interpsectors,
+				 2*maxinterpsectors*sizeof(*interpsectors));
+	interpsavedsectors = realloc (interpsavedsectors,
+				      2*maxinterpsectors*sizeof(*interpsavedsectors));
+	
+	if (!interpsectors || !interpsavedsectors)
+	    I_Error ("P_StoreInterpolation: couldn't allocate %i sectors",
+		     maxinterpsectors);
+    }
+
+    numinterpmobjs = 0;
+    for (th=thinkercaps[th_mobj].cnext ; th != &thinkercaps[th_mobj] ; th=th->cnext)
+    {
+	if (th->function.acp1 != (actionf_p1)P_MobjThinker)
+	    continue;
+	
+	mo = (mobj_t *)th;
+	interpmobjs[numinterpmobjs].mobj = mo;
+	interpmobjs[numinterpmobjs].x = mo->x;
+	interpmobjs[numinterpmobjs].y = mo->y;
+	interpmobjs[numinterpmobjs].z = mo->z;
+	interpmobjs[numinterpmobjs].angle = mo->angle;
+	numinterpmobjs++;
+    }
+
+    for (i=0 ; i<numsectors ; i++)
+    {
+	interpsectors[i*2] = sectors[i].floorheight;
+	interpsectors[i*2+1] = sectors[i].ceilingheight;
+    }
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+	interpviewz[i] = players[i].viewz;
+
+    interpolationtic = gametic;
+}
+
+
+//
+// P_ResetInterpolation
+// A teleported thing must not slide to its destination.
+//
+void P_ResetInterpolation (mobj_t* mobj)
+{
+    int		i;
+
+    for (i=0 ; i<numinterpmobjs ; i++)
+    {
+	if (interpmobjs[i].mobj == mobj)
+	{
+	    interpmobjs[i].x = mobj->x;
+	    interpmobjs[i].y = mobj->y;
+	    interpmobjs[i].z = mobj->z;
+	    interpmobjs[i].angle = mobj->angle;
+	}
+    }
+
+    if (mobj->player)
+	interpviewz[mobj->player-players] = mobj->player->viewz;
+}
+
+
+//
+// P_BeginInterpolation
+// frac is the time elapsed in the current tic.
+// Nothing is done if the last tic did not store
+//  the positions, e.g. when paused or in the menu.
+//
+#define LERP(from,to,frac)	((from) + FixedMul ((to)-(from), (frac)))
+
+void P_BeginInterpolation (fixed_t frac)
+{
+    interpmobj_t*	from;
+    interpmobj_t*	saved;
+    mobj_t*		mo;
+    sector_t*		sec;
+    int			i;
+
+    if (interpolating
+	|| frac >= FRACUNIT
+	|| gamestate != GS_LEVEL
+	|| interpolationtic != gametic-1)
+	return;
+
+    interpolating = true;
+
+    for (i=0 ; i<numinterpmobjs ; i++)
+    {
+	from = &interpmobjs[i];
+	saved = &interpsaved[i];
+	mo = from->mobj;
+
+	if (mo->thinker.function.acp1 != (actionf_p1)P_MobjThinker)
+	    continue;
+
+	saved->x = mo->x;
+	saved->y = mo->y;
+	saved->z = mo->z;
+	saved->angle = mo->angle;
+
+	mo->x = LERP(from->x, mo->x, frac);
+	mo->y = LERP(from->y, mo->y, frac);
+	mo->z = LERP(from->z, mo->z, frac);
+	mo->angle = from->angle + FixedMul ((int)(mo->angle - from->angle), frac);
+    }
+
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+    {
+	interpsavedsectors[i*2] = sec->floorheight;
+	interpsavedsectors[i*2+1] = sec->ceilingheight;
+	sec->floorheight = LERP(interpsectors[i*2], sec->floorheight, frac);
+	sec->ceilingheight = LERP(interpsectors[i*2+1], sec->ceilingheight, frac);
+    }
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+    {
+	interpsavedviewz[i] = players[i].viewz;
+	players[i].viewz = LERP(interpviewz[i], players[i].viewz, frac);
+    }
+}
+
+
+//
+// P_EndInterpolation
+// Puts the game values back.
+//
+void P_EndInterpolation (void)
+{
+    interpmobj_t*	saved;
+    mobj_t*		mo;
+    sector_t*		sec;
+    int			i;
+
+    if (!interpolating)
+	return;
+
+    interpolating = false;
+
+    for (i=0 ; i<numinterpmobjs ; i++)
+    {
+	saved = &interpsaved[i];
+	mo = interpmobjs[i].mobj;
+
+	if (mo->thinker.function.acp1 != (actionf_p1)P_MobjThinker)
+	    continue;
+
+	mo->x = saved->x;
+	mo->y = saved->y;
+	mo->z = saved->z;
+	mo->angle = saved->angle;
+    }
+
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+    {
+	sec->floorheight = interpsavedsectors[i*2];
+	sec->ceilingheight = interpsavedsectors[i*2+1];
+    }
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+	players[i].viewz = interpsavedviewz[i];
+}
+
+
+
 //
 // P_Ticker
 //
@@ -141,13 +420,21 @@ void P_Ticker (void)
 	return;
     }
     
+
+    // where things are before the tic, for the interpolated refresh
+    if (g_uncapped)
+	P_StoreInterpolation ();
 		
     for (i=0 ; i<MAXPLAYERS ; i++)
 	if (playeringame[i])
 	    P_PlayerThink (&players[i]);
 			
+    PROF_BEGIN (prof_thinkers);
     P_RunThinkers ();
+    PROF_END (prof_thinkers);
+    PROF_BEGIN (prof_specials);
     P_UpdateSpecials ();
+    PROF_END (prof_specials);
     P_RespawnSpecials ();
 
     // for par times
@@ -24,6 +24,8 @@
 #define __P_TICK__
 
 
+#include "p_mobj.h"
+
 #ifdef __GNUG__
 #pragma interface
 #endif
@@ -34,6 +36,12 @@
 // Carries out all thinking of monsters and players.
 void P_Ticker (void);
 
+// Interpolated refresh between two tics, see -uncapped.
+void P_StoreInterpolation (void);
+void P_ResetInterpolation (mobj_t* mobj);
+void P_BeginInterpolation (fixed_t frac);
+void P_EndInterpolation (void);
+
 
 
 #endif
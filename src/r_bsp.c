@@ -21,6 +21,8 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stdlib.h>
+
 #include "doomdef.h"
 
 #include "m_bbox.h"
@@ -45,8 +47,10 @@ line_t*		linedef;
 sector_t*	frontsector;
 sector_t*	backsector;
 
-drawseg_t	drawsegs[MAXDRAWSEGS];
+// Grows by doubling, MAXDRAWSEGS is only its initial size.
+drawseg_t*	drawsegs;
 drawseg_t*	ds_p;
+int		maxdrawsegs;
 
 
 void
@@ -66,6 +70,32 @@ void R_ClearDrawSegs (void)
 }
 
 
+//
+// R_NewDrawSeg
+// Makes room for one more drawseg at ds_p.
+// Nothing points into the drawsegs before
+//  the masked drawing, they can be moved.
+//
+void R_NewDrawSeg (void)
+{
+    int		numdrawsegs;
+
+    if (ds_p != drawsegs + maxdrawsegs)
+	return;
+
+    numdrawsegs = ds_p - drawsegs;
+    maxdrawsegs = maxdrawsegs ? maxdrawsegs*2 : MAXDRAWSEGS;
+    drawsegs = realloc (drawsegs, maxdrawsegs*sizeof(*drawsegs));
+
+    if (!drawsegs)
+	I_Error ("R_NewDrawSeg: couldn't allocate %i drawsegs",
+		 maxdrawsegs);
+    
+    ds_p = drawsegs + numdrawsegs;
+    I_Debug ("R_NewDrawSeg: %i drawsegs", maxdrawsegs);
+}
+
+
 
 //
 // ClipWallSegment
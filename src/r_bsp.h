@@ -45,7 +45,7 @@ extern boolean		markceiling;
 
 extern boolean		skymap;
 
-extern drawseg_t	drawsegs[MAXDRAWSEGS];
+extern drawseg_t*	drawsegs;
 extern drawseg_t*	ds_p;
 
 extern lighttable_t**	hscalelight;
@@ -59,6 +59,7 @@ typedef void (*drawfunc_t) (int start, int stop);
 // BSP?
 void R_ClearClipSegs (void);
 void R_ClearDrawSegs (void);
+void R_NewDrawSeg (void);
 
 
 void R_RenderBSPNode (int bspnum);
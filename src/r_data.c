@@ -23,10 +23,15 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "i_system.h"
 #include "z_zone.h"
 
 #include "m_swap.h"
+#include "m_misc.h"
 
 #include "w_wad.h"
 
@@ -632,6 +637,335 @@ void R_InitColormaps (void)
 
 
 
+//
+// TEXTURE AND SPRITE TABLES CACHING
+// With -datacache, the tables built from the
+//  texture definitions, the patches and the sprites
+//  are written to a file on the first start, and
+//  read back at once on the next ones, as long as
+//  the WAD set is the same.
+// The file is made of arrays, the pointers are
+//  rebuilt from the counts.
+//
+#define DATAMAGIC	"DTEX"
+#define DATAVERSION	1
+
+typedef struct
+{
+    char	magic[4];
+    int		version;
+    uint64_t	key;
+    int		size;		// of the whole file
+
+    int		numtextures;
+    int		numcolumns;	// widths of all textures
+    int		numspritelumps;
+    int		numsprites;
+    int		numframes;	// of all sprites
+
+    // from the start of the file
+    int		texturedefs;	// texture_t, 8 bytes aligned each
+    int		widthmasks;
+    int		heights;
+    int		compositesizes;
+    int		columnlumps;
+    int		columnofs;
+    int		spritewidths;
+    int		spriteoffsets;
+    int		spritetopoffsets;
+    int		spritenames;	// 4 characters each
+    int		spritecounts;	// frames of each sprite
+    int		spriteframes;
+
+} datacache_t;
+
+#define DATAALIGN(n)	(((n) + 7) & ~7)
+#define TEXTURESIZE(t) \
+    DATAALIGN(sizeof(texture_t) + sizeof(texpatch_t)*((t)->patchcount-1))
+
+// Read by R_InitData, for R_InitSprites.
+static datacache_t*	datacache;
+
+
+//
+// R_DataCacheKey
+//
+static uint64_t R_DataCacheKey (void)
+{
+    uint64_t	key;
+    int		sizes[5];
+
+    sizes[0] = DATAVERSION;
+    sizes[1] = sizeof(texture_t);
+    sizes[2] = sizeof(texpatch_t);
+    sizes[3] = sizeof(spriteframe_t);
+    sizes[4] = NUMSPRITES;
+
+    key = W_WadKey ();
+    return M_HashBytes (key, sizes, sizeof(sizes));
+}
+
+
+//
+// R_ReadDataCache
+// Sets up the texture and sprite lump tables
+//  from the cache file, instead of
+//  R_InitTextures and R_InitSpriteLumps.
+//
+static boolean R_ReadDataCache (void)
+{
+    datacache_t		header;
+    byte*		cache;
+    byte*		texturedef;
+    short*		columnlumps;
+    unsigned short*	columnofs;
+    FILE*		handle;
+    int			count;
+    int			i;
+
+    if (!g_datacache_file)
+	return false;
+
+    handle = fopen (g_datacache_file, "rb");
+    if (!handle)
+	return false;
+
+    if (fread (&header, sizeof(header), 1, handle) != 1
+	|| memcmp (header.magic, DATAMAGIC, 4)
+	|| header.version != DATAVERSION
+	|| header.size < (int)sizeof(header)
+	|| header.spriteframes + header.numframes*(int)sizeof(spriteframe_t) > header.size
+	|| header.key != R_DataCacheKey ())
+    {
+	I_Debug ("R_ReadDataCache: %s is stale", g_datacache_file);
+	fclose (handle);
+	return false;
+    }
+
+    cache = Z_Malloc (header.size, PU_STATIC, 0);
+    memcpy (cache, &header, sizeof(header));
+    count = header.size - sizeof(header);
+    if (fread (cache + sizeof(header), count, 1, handle) != 1)
+    {
+	I_Alert ("R_ReadDataCache: unable to read %s", g_datacache_file);
+	fclose (handle);
+	Z_Free (cache);
+	return false;
+    }
+    fclose (handle);
+
+    // textures
+    numtextures = header.numtextures;
+    textures = Z_Malloc (numtextures*sizeof(*textures), PU_STATIC, 0);
+    texturecolumnlump = Z_Malloc (numtextures*sizeof(*texturecolumnlump), PU_STATIC, 0);
+    texturecolumnofs = Z_Malloc (numtextures*sizeof(*texturecolumnofs), PU_STATIC, 0);
+    texturecomposite = Z_Malloc (numtextures*sizeof(*texturecomposite), PU_STATIC, 0);
+    texturewidthmask = (int *)(cache+header.widthmasks);
+    textureheight = (fixed_t *)(cache+header.heights);
+    texturecompositesize = (int *)(cache+header.compositesizes);
+
+    texturedef = cache+header.texturedefs;
+    columnlumps = (short *)(cache+header.columnlumps);
+    columnofs = (unsigned short *)(cache+header.columnofs);
+    for (i=0 ; i<numtextures ; i++)
+    {
+	textures[i] = (texture_t *)texturedef;
+	texturedef += TEXTURESIZE(textures[i]);
+	texturecolumnlump[i] = columnlumps;
+	texturecolumnofs[i] = columnofs;
+	columnlumps += textures[i]->width;
+	columnofs += textures[i]->width;
+	texturecomposite[i] = 0;
+    }
+
+    texturetranslation = Z_Malloc ((numtextures+1)*sizeof(*texturetranslation), PU_STATIC, 0);
+    for (i=0 ; i<numtextures ; i++)
+	texturetranslation[i] = i;
+
+    // sprite lumps
+    firstspritelump = W_GetNumForName ("S_START") + 1;
+    lastspritelump = W_GetNumForName ("S_END") - 1;
+    numspritelumps = header.numspritelumps;
+    spritewidth = (fixed_t *)(cache+header.spritewidths);
+    spriteoffset = (fixed_t *)(cache+header.spriteoffsets);
+    spritetopoffset = (fixed_t *)(cache+header.spritetopoffsets);
+
+    datacache = (datacache_t *)cache;
+    I_Debug ("R_ReadDataCache: %s, %i KB", g_datacache_file, header.size / 1024);
+    return true;
+}
+
+
+//
+// R_CachedSpriteDefs
+// Sets up the sprite frames read by R_InitData,
+//  if the cache file has the same sprite names.
+//
+boolean R_CachedSpriteDefs (char** namelist)
+{
+    byte*		cache;
+    char*		names;
+    int*		counts;
+    spriteframe_t*	frames;
+    int			i;
+
+    if (!datacache)
+	return false;
+
+    cache = (byte *)datacache;
+    names = (char *)(cache+datacache->spritenames);
+    for (i=0 ; i<datacache->numsprites ; i++)
+    {
+	if (!namelist[i] || memcmp (namelist[i], names+i*4, 4))
+	    return false;
+    }
+
+    numsprites = datacache->numsprites;
+    if (!numsprites)
+	return true;
+
+    sprites = Z_Malloc (numsprites*sizeof(*sprites), PU_STATIC, NULL);
+    counts = (int *)(cache+datacache->spritecounts);
+    frames = (spriteframe_t *)(cache+datacache->spriteframes);
+    for (i=0 ; i<numsprites ; i++)
+    {
+	sprites[i].numframes = counts[i];
+	sprites[i].spriteframes = counts[i] ? frames : NULL;
+	frames += counts[i];
+    }
+    return true;
+}
+
+
+//
+// R_WriteDataCache
+// Called once the sprite frames are built.
+//
+void R_WriteDataCache (char** namelist)
+{
+    datacache_t*	header;
+    byte*		cache;
+    byte*		texturedef;
+    int*		counts;
+    FILE*		handle;
+    char		tempname[1024];
+    int			size;
+    int			offset;
+    int			i;
+
+    if (!g_datacache_file)
+	return;
+
+    header = calloc (1, sizeof(*header));
+    if (!header)
+	return;
+
+    // lay out the sections
+    size = 0;
+    for (i=0 ; i<numtextures ; i++)
+    {
+	header->numcolumns += textures[i]->width;
+	size += TEXTURESIZE(textures[i]);
+    }
+    for (i=0 ; i<numsprites ; i++)
+	header->numframes += sprites[i].numframes;
+
+    offset = DATAALIGN(sizeof(datacache_t));
+    header->texturedefs = offset;
+    offset = DATAALIGN(offset + size);
+    header->widthmasks = offset;
+    offset = DATAALIGN(offset + numtextures*sizeof(*texturewidthmask));
+    header->heights = offset;
+    offset = DATAALIGN(offset + numtextures*sizeof(*textureheight));
+    header->compositesizes = offset;
+    offset = DATAALIGN(offset + numtextures*sizeof(*texturecompositesize));
+    header->columnlumps = offset;
+    offset = DATAALIGN(offset + header->numcolumns*sizeof(short));
+    header->columnofs = offset;
+    offset = DATAALIGN(offset + header->numcolumns*sizeof(unsigned short));
+    header->spritewidths = offset;
+    offset = DATAALIGN(offset + numspritelumps*sizeof(fixed_t));
+    header->spriteoffsets = offset;
+    offset = DATAALIGN(offset + numspritelumps*sizeof(fixed_t));
+    header->spritetopoffsets = offset;
+    offset = DATAALIGN(offset + numspritelumps*sizeof(fixed_t));
+    header->spritenames = offset;
+    offset = DATAALIGN(offset + numsprites*4);
+    header->spritecounts = offset;
+    offset = DATAALIGN(offset + numsprites*sizeof(int));
+    header->spriteframes = offset;
+    offset = DATAALIGN(offset + header->numframes*sizeof(spriteframe_t));
+
+    cache = calloc (1, offset);
+    if (!cache)
+    {
+	free (header);
+	return;
+    }
+
+    memcpy (header->magic, DATAMAGIC, 4);
+    header->version = DATAVERSION;
+    header->key = R_DataCacheKey ();
+    header->size = offset;
+    header->numtextures = numtextures;
+    header->numspritelumps = numspritelumps;
+    header->numsprites = numsprites;
+    memcpy (cache, header, sizeof(*header));
+
+    texturedef = cache+header->texturedefs;
+    offset = 0;
+    for (i=0 ; i<numtextures ; i++)
+    {
+	memcpy (texturedef, textures[i],
+		sizeof(texture_t) + sizeof(texpatch_t)*(textures[i]->patchcount-1));
+	texturedef += TEXTURESIZE(textures[i]);
+
+	memcpy (cache+header->columnlumps+offset*sizeof(short),
+		texturecolumnlump[i], textures[i]->width*sizeof(short));
+	memcpy (cache+header->columnofs+offset*sizeof(unsigned short),
+		texturecolumnofs[i], textures[i]->width*sizeof(unsigned short));
+	offset += textures[i]->width;
+    }
+    memcpy (cache+header->widthmasks, texturewidthmask, numtextures*sizeof(*texturewidthmask));
+    memcpy (cache+header->heights, textureheight, numtextures*sizeof(*textureheight));
+    memcpy (cache+header->compositesizes, texturecompositesize, numtextures*sizeof(*texturecompositesize));
+
+    memcpy (cache+header->spritewidths, spritewidth, numspritelumps*sizeof(fixed_t));
+    memcpy (cache+header->spriteoffsets, spriteoffset, numspritelumps*sizeof(fixed_t));
+    memcpy (cache+header->spritetopoffsets, spritetopoffset, numspritelumps*sizeof(fixed_t));
+
+    counts = (int *)(cache+header->spritecounts);
+    offset = header->spriteframes;
+    for (i=0 ; i<numsprites ; i++)
+    {
+	memcpy (cache+header->spritenames+i*4, namelist[i], 4);
+	counts[i] = sprites[i].numframes;
+	memcpy (cache+offset, sprites[i].spriteframes, counts[i]*sizeof(spriteframe_t));
+	offset += counts[i]*sizeof(spriteframe_t);
+    }
+
+    // written aside then renamed, another instance
+    //  starting never reads half a file
+    snprintf (tempname, sizeof(tempname), "%s.tmp", g_datacache_file);
+
+    handle = fopen (tempname, "wb");
+    if (!handle)
+	I_Alert ("R_WriteDataCache: unable to create %s", tempname);
+    else if ((fwrite (cache, header->size, 1, handle) != 1) | (fclose (handle) != 0)
+	     || rename (tempname, g_datacache_file))
+    {
+	I_Alert ("R_WriteDataCache: unable to write %s", g_datacache_file);
+	remove (tempname);
+    }
+    else
+	I_Debug ("R_WriteDataCache: %s, %i KB", g_datacache_file, header->size / 1024);
+
+    free (cache);
+    free (header);
+}
+
+
+
 //
 // R_InitData
 // Locates all the lumps
@@ -640,12 +974,15 @@ void R_InitColormaps (void)
 //
 void R_InitData (void)
 {
-    R_InitTextures ();
-    I_Debug ("InitTextures");
+    if (!R_ReadDataCache ())
+    {
+	R_InitTextures ();
+	I_Debug ("InitTextures");
+	R_InitSpriteLumps ();
+	I_Debug ("InitSprites");
+    }
     R_InitFlats ();
     I_Debug ("InitFlats");
-    R_InitSpriteLumps ();
-    I_Debug ("InitSprites");
     R_InitColormaps ();
     I_Debug ("InitColormaps");
 }
@@ -661,7 +998,7 @@ int R_FlatNumForName (char* name)
     int		i;
     char	namet[9];
 
-    i = W_CheckNumForName (name);
+    i = W_CheckNumForNameNS (name, ns_flats);
 
     if (i == -1)
     {
@@ -697,6 +1034,26 @@ int	R_CheckTextureNumForName (char *name)
 
 
 
+//
+// R_PrefetchTexture
+//
+void R_PrefetchTexture (char* name)
+{
+    texture_t*	texture;
+    int		tex;
+    int		i;
+
+    tex = R_CheckTextureNumForName (name);
+    if (tex <= 0)
+	return;
+
+    texture = textures[tex];
+    for (i=0 ; i<texture->patchcount ; i++)
+	W_PrefetchLump (texture->patches[i].patch);
+}
+
+
+
 //
 // R_TextureNumForName
 // Calls R_CheckTextureNumForName,
@@ -806,7 +1163,7 @@ void R_PrecacheLevel (void)
     spritepresent = alloca(numsprites);
     memset (spritepresent,0, numsprites);
 	
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    for (th = thinkercaps[th_mobj].cnext ; th != &thinkercaps[th_mobj] ; th=th->cnext)
     {
 	if (th->function.acp1 == (actionf_p1)P_MobjThinker)
 	    spritepresent[((mobj_t *)th)->sprite] = 1;
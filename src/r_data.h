@@ -42,6 +42,11 @@ R_GetColumn
 void R_InitData (void);
 void R_PrecacheLevel (void);
 
+// The sprite frames from the -datacache file,
+//  false if they must be built.
+boolean R_CachedSpriteDefs (char** namelist);
+void R_WriteDataCache (char** namelist);
+
 
 // Retrieval.
 // Floor/ceiling opaque texture tiles,
@@ -54,6 +59,10 @@ int R_FlatNumForName (char* name);
 int R_TextureNumForName (char *name);
 int R_CheckTextureNumForName (char *name);
 
+// Reads ahead the patches of a texture,
+//  from a W_StartPrefetch task.
+void R_PrefetchTexture (char* name);
+
 #endif
 //-----------------------------------------------------------------------------
 //
@@ -457,25 +457,22 @@ typedef struct
 //
 // Now what is a visplane, anyway?
 // 
-typedef struct
+typedef struct visplane_s
 {
   fixed_t		height;
   int			picnum;
   int			lightlevel;
   int			minx;
   int			maxx;
+
+  // next in the R_FindPlane hash chain
+  struct visplane_s*	next;
   
-  // leave pads for [minx-1]/[maxx+1]
-  
-  byte		pad1;
-  // Here lies the rub for all
-  //  dynamic resize/change of resolution.
-  byte		top[SCREENWIDTH];
-  byte		pad2;
-  byte		pad3;
-  // See above.
-  byte		bottom[SCREENWIDTH];
-  byte		pad4;
+  // [SCREENWIDTH] entries allocated with the render resolution,
+  //  leave pads for [minx-1]/[maxx+1].
+  // Unused columns are marked with 0xffff.
+  unsigned short*	top;
+  unsigned short*	bottom;
 
 } visplane_t;
 
@@ -23,6 +23,9 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "doomdef.h"
 
 #include "i_system.h"
@@ -37,13 +40,18 @@
 // State.
 #include "doomstat.h"
 
+// Vectorized drawers, selected at runtime.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+    && !defined(__EMSCRIPTEN__)
+#define SIMD_X86
+#include <emmintrin.h>
+#endif
+
 
 // ?
-#define MAXWIDTH			1120
-#define MAXHEIGHT			832
 
 // status bar height at bottom of screen
-#define SBARHEIGHT		32
+#define SBARHEIGHT		SCALEY(32)
 
 //
 // All drawing to the view buffer is accomplished in this file.
@@ -61,8 +69,9 @@ int		scaledviewwidth;
 int		viewheight;
 int		viewwindowx;
 int		viewwindowy; 
-byte*		ylookup[MAXHEIGHT]; 
-int		columnofs[MAXWIDTH]; 
+// SCREENHEIGHT and SCREENWIDTH long, see R_InitBuffer.
+byte**		ylookup; 
+int*		columnofs; 
 
 // Color tables for different players,
 //  translate a limited part to another
@@ -77,15 +86,15 @@ byte		translations[3][256];
 // R_DrawColumn
 // Source is the top of the column to scale.
 //
-lighttable_t*		dc_colormap; 
-int			dc_x; 
-int			dc_yl; 
-int			dc_yh; 
-fixed_t			dc_iscale; 
-fixed_t			dc_texturemid;
+I_THREAD_LOCAL lighttable_t*		dc_colormap; 
+I_THREAD_LOCAL int			dc_x; 
+I_THREAD_LOCAL int			dc_yl; 
+I_THREAD_LOCAL int			dc_yh; 
+I_THREAD_LOCAL fixed_t			dc_iscale; 
+I_THREAD_LOCAL fixed_t			dc_texturemid;
 
 // first pixel in a column (possibly virtual) 
-byte*			dc_source;		
+I_THREAD_LOCAL byte*			dc_source;		
 
 // just for profiling 
 int			dccount;
@@ -252,7 +261,8 @@ void R_DrawColumnLow (void)
 // Spectre/Invisibility.
 //
 #define FUZZTABLE		50 
-#define FUZZOFF	(SCREENWIDTH)
+// Scaled by SCREENWIDTH at use, one row up or down.
+#define FUZZOFF	(1)
 
 
 int	fuzzoffset[FUZZTABLE] =
@@ -266,7 +276,7 @@ int	fuzzoffset[FUZZTABLE] =
     FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF 
 }; 
 
-int	fuzzpos = 0; 
+I_THREAD_LOCAL int	fuzzpos = 0; 
 
 
 //
@@ -350,7 +360,7 @@ void R_DrawFuzzColumn (void)
 	//  a pixel that is either one column
 	//  left or right of the current one.
 	// Add index from colormap to index.
-	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]]]; 
+	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]*SCREENWIDTH]]; 
 
 	// Clamp table lookup index.
 	if (++fuzzpos == FUZZTABLE) 
@@ -375,7 +385,7 @@ void R_DrawFuzzColumn (void)
 //  of the BaronOfHell, the HellKnight, uses
 //  identical sprites, kinda brightened up.
 //
-byte*	dc_translation;
+I_THREAD_LOCAL byte*	dc_translation;
 byte*	translationtables;
 
 void R_DrawTranslatedColumn (void) 
@@ -493,19 +503,19 @@ void R_InitTranslationTables (void)
 // In consequence, flats are not stored by column (like walls),
 //  and the inner loop has to step in texture space u and v.
 //
-int			ds_y; 
-int			ds_x1; 
-int			ds_x2;
+I_THREAD_LOCAL int			ds_y; 
+I_THREAD_LOCAL int			ds_x1; 
+I_THREAD_LOCAL int			ds_x2;
 
-lighttable_t*		ds_colormap; 
+I_THREAD_LOCAL lighttable_t*		ds_colormap; 
 
-fixed_t			ds_xfrac; 
-fixed_t			ds_yfrac; 
-fixed_t			ds_xstep; 
-fixed_t			ds_ystep;
+I_THREAD_LOCAL fixed_t			ds_xfrac; 
+I_THREAD_LOCAL fixed_t			ds_yfrac; 
+I_THREAD_LOCAL fixed_t			ds_xstep; 
+I_THREAD_LOCAL fixed_t			ds_ystep;
 
 // start of a 64*64 tile image 
-byte*			ds_source;	
+I_THREAD_LOCAL byte*			ds_source;	
 
 // just for profiling
 int			dscount;
@@ -681,6 +691,675 @@ void R_DrawSpanLow (void)
     } while (count--); 
 }
 
+//
+// Vectorized drawers.
+// The fixed point DDA of R_DrawColumn and R_DrawSpan
+//  is computed for 4 pixels at once with SSE2,
+//  with the same wrapping 32 bits arithmetic, so the
+//  output is bit-identical to the C drawers.
+// The texels are fetched one by one: the byte wide
+//  gathers of AVX2 read past the texel, out of the
+//  source and the colormap, for no measurable gain.
+// Column pixels are a screen row apart, so only the
+//  index computation and the lookups are vectorized.
+//
+#ifdef SIMD_X86
+
+__attribute__((target("sse2")))
+static void R_DrawColumnSSE2 (void) 
+{ 
+    int			count; 
+    byte*		dest; 
+    fixed_t		frac;
+    fixed_t		fracstep;	 
+    __m128i		vfrac;
+    __m128i		vstep;
+    __m128i		vmask;
+    int			index[4];
+ 
+    count = dc_yh - dc_yl; 
+
+    if (count < 0) 
+	return; 
+				 
+#ifdef RANGECHECK 
+    if ((unsigned)dc_x >= SCREENWIDTH
+	|| dc_yl < 0
+	|| dc_yh >= SCREENHEIGHT) 
+	I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x); 
+#endif 
+
+    dest = ylookup[dc_yl] + columnofs[dc_x];  
+
+    fracstep = dc_iscale; 
+    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
+
+    // Pixel count from here on.
+    count++;
+
+    vfrac = _mm_setr_epi32 (frac,
+			    (unsigned)frac + (unsigned)fracstep,
+			    (unsigned)frac + (unsigned)fracstep*2,
+			    (unsigned)frac + (unsigned)fracstep*3);
+    vstep = _mm_set1_epi32 ((unsigned)fracstep*4);
+    vmask = _mm_set1_epi32 (127);
+
+    while (count >= 4)
+    {
+	_mm_storeu_si128 ((__m128i*)index,
+			  _mm_and_si128 (_mm_srai_epi32 (vfrac, FRACBITS), vmask));
+	
+	dest[0] = dc_colormap[dc_source[index[0]]];
+	dest[SCREENWIDTH] = dc_colormap[dc_source[index[1]]];
+	dest[SCREENWIDTH*2] = dc_colormap[dc_source[index[2]]];
+	dest[SCREENWIDTH*3] = dc_colormap[dc_source[index[3]]];
+	
+	vfrac = _mm_add_epi32 (vfrac, vstep);
+	dest += SCREENWIDTH*4;
+	count -= 4;
+    }
+
+    frac = _mm_cvtsi128_si32 (vfrac);
+    
+    while (count > 0)
+    {
+	*dest = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
+	
+	dest += SCREENWIDTH; 
+	frac = (unsigned)frac + (unsigned)fracstep;
+	count--;
+    }
+} 
+
+
+__attribute__((target("sse2")))
+static void R_DrawSpanSSE2 (void) 
+{ 
+    fixed_t		xfrac;
+    fixed_t		yfrac; 
+    byte*		dest; 
+    int			count;
+    int			spot; 
+    __m128i		vxfrac;
+    __m128i		vyfrac;
+    __m128i		vxstep;
+    __m128i		vystep;
+    __m128i		vxmask;
+    __m128i		vymask;
+    int			index[4];
+    unsigned		pixels;
+	 
+#ifdef RANGECHECK 
+    if (ds_x2 < ds_x1
+	|| ds_x1<0
+	|| ds_x2>=SCREENWIDTH  
+	|| (unsigned)ds_y>SCREENHEIGHT)
+    {
+	I_Error( "R_DrawSpan: %i to %i at %i",
+		 ds_x1,ds_x2,ds_y);
+    }
+#endif 
+
+    xfrac = ds_xfrac; 
+    yfrac = ds_yfrac; 
+	 
+    dest = ylookup[ds_y] + columnofs[ds_x1];
+
+    // Pixel count.
+    count = ds_x2 - ds_x1 + 1; 
+
+    vxfrac = _mm_setr_epi32 (xfrac,
+			     (unsigned)xfrac + (unsigned)ds_xstep,
+			     (unsigned)xfrac + (unsigned)ds_xstep*2,
+			     (unsigned)xfrac + (unsigned)ds_xstep*3);
+    vyfrac = _mm_setr_epi32 (yfrac,
+			     (unsigned)yfrac + (unsigned)ds_ystep,
+			     (unsigned)yfrac + (unsigned)ds_ystep*2,
+			     (unsigned)yfrac + (unsigned)ds_ystep*3);
+    vxstep = _mm_set1_epi32 ((unsigned)ds_xstep*4);
+    vystep = _mm_set1_epi32 ((unsigned)ds_ystep*4);
+    vxmask = _mm_set1_epi32 (63);
+    vymask = _mm_set1_epi32 (63*64);
+
+    while (count >= 4)
+    {
+	_mm_storeu_si128 ((__m128i*)index,
+			  _mm_add_epi32 (_mm_and_si128 (_mm_srli_epi32 (vyfrac, 16-6), vymask),
+					 _mm_and_si128 (_mm_srli_epi32 (vxfrac, 16), vxmask)));
+
+	pixels = ds_colormap[ds_source[index[0]]]
+	    | ds_colormap[ds_source[index[1]]] << 8
+	    | ds_colormap[ds_source[index[2]]] << 16
+	    | (unsigned)ds_colormap[ds_source[index[3]]] << 24;
+	memcpy (dest, &pixels, 4);
+	
+	vxfrac = _mm_add_epi32 (vxfrac, vxstep);
+	vyfrac = _mm_add_epi32 (vyfrac, vystep);
+	dest += 4;
+	count -= 4;
+    }
+
+    xfrac = _mm_cvtsi128_si32 (vxfrac);
+    yfrac = _mm_cvtsi128_si32 (vyfrac);
+
+    while (count > 0)
+    {
+	spot = ((yfrac>>(16-6))&(63*64)) + ((xfrac>>16)&63);
+	*dest++ = ds_colormap[ds_source[spot]];
+
+	xfrac = (unsigned)xfrac + (unsigned)ds_xstep; 
+	yfrac = (unsigned)yfrac + (unsigned)ds_ystep;
+	count--;
+    }
+} 
+
+
+//
+// R_TestDrawFuncs
+// With -simdtest, runs random columns and spans
+//  through the C drawers and a vectorized pair,
+//  and compares the frame buffers.
+// The second frame buffer is reached by offsetting
+//  columnofs, so both drawers see the same ylookup.
+//
+#define TESTDRAWCASES		8192
+
+static unsigned	testseed;
+
+static int R_TestRandom (void)
+{
+    // xorshift32
+    testseed ^= testseed << 13;
+    testseed ^= testseed >> 17;
+    testseed ^= testseed << 5;
+    return testseed;
+}
+
+static void
+R_TestDrawFuncs
+( const char*	name,
+  void		(*testcolfunc) (void),
+  void		(*testspanfunc) (void) )
+{
+    int		size;
+    byte*	screen;
+    byte*	source;
+    byte*	colormap;
+    byte**	saveylookup;
+    int*	savecolumnofs;
+    int		savecentery;
+    int		i;
+    int		x;
+    int		y;
+    int		test;
+
+    size = SCREENWIDTH*SCREENHEIGHT;
+    screen = calloc (2, size);
+    source = malloc (64*64);
+    colormap = malloc (256);
+    
+    saveylookup = ylookup;
+    savecolumnofs = columnofs;
+    ylookup = malloc (SCREENHEIGHT*sizeof(*ylookup));
+    columnofs = malloc (SCREENWIDTH*sizeof(*columnofs));
+    
+    if (!screen || !source || !colormap || !ylookup || !columnofs)
+	I_Error ("R_TestDrawFuncs: out of memory");
+
+    testseed = 0x1d872b41;
+    for (i=0 ; i<64*64 ; i++)
+	source[i] = R_TestRandom ();
+    for (i=0 ; i<256 ; i++)
+	colormap[i] = R_TestRandom ();
+    
+    savecentery = centery;
+
+    for (i=0 ; i<SCREENHEIGHT ; i++)
+	ylookup[i] = screen + i*SCREENWIDTH;
+
+    for (test=0 ; test<TESTDRAWCASES ; test++)
+    {
+	// Columns, from short and magnified to long and minified.
+	dc_x = (unsigned)R_TestRandom () % SCREENWIDTH;
+	dc_yl = (unsigned)R_TestRandom () % SCREENHEIGHT;
+	dc_yh = dc_yl + (unsigned)R_TestRandom () % (SCREENHEIGHT-dc_yl);
+	dc_iscale = R_TestRandom () >> (R_TestRandom () & 15);
+	dc_texturemid = R_TestRandom ();
+	dc_source = source;
+	dc_colormap = colormap;
+	centery = (unsigned)R_TestRandom () % SCREENHEIGHT;
+
+	for (i=0 ; i<SCREENWIDTH ; i++)
+	    columnofs[i] = i;
+	R_DrawColumn ();
+	for (i=0 ; i<SCREENWIDTH ; i++)
+	    columnofs[i] = i + size;
+	testcolfunc ();
+
+	for (y=0 ; y<SCREENHEIGHT ; y++)
+	{
+	    if (screen[y*SCREENWIDTH+dc_x] != screen[size+y*SCREENWIDTH+dc_x])
+		I_Error ("R_TestDrawFuncs: %s column %i to %i at %i differs",
+			 name, dc_yl, dc_yh, dc_x);
+	}
+
+	// Spans, with any step.
+	ds_y = (unsigned)R_TestRandom () % SCREENHEIGHT;
+	ds_x1 = (unsigned)R_TestRandom () % SCREENWIDTH;
+	ds_x2 = ds_x1 + (unsigned)R_TestRandom () % (SCREENWIDTH-ds_x1);
+	ds_xfrac = R_TestRandom ();
+	ds_yfrac = R_TestRandom ();
+	ds_xstep = R_TestRandom () >> (R_TestRandom () & 15);
+	ds_ystep = R_TestRandom () >> (R_TestRandom () & 15);
+	ds_source = source;
+	ds_colormap = colormap;
+
+	for (i=0 ; i<SCREENWIDTH ; i++)
+	    columnofs[i] = i;
+	R_DrawSpan ();
+	for (i=0 ; i<SCREENWIDTH ; i++)
+	    columnofs[i] = i + size;
+	testspanfunc ();
+
+	for (x=0 ; x<SCREENWIDTH ; x++)
+	{
+	    if (screen[ds_y*SCREENWIDTH+x] != screen[size+ds_y*SCREENWIDTH+x])
+		I_Error ("R_TestDrawFuncs: %s span %i to %i at %i differs",
+			 name, ds_x1, ds_x2, ds_y);
+	}
+    }
+
+    if (memcmp (screen, screen+size, size))
+	I_Error ("R_TestDrawFuncs: %s frame buffers differ", name);
+    
+    I_Print ("R_TestDrawFuncs: %s drawers match the C drawers (%d cases)",
+	     name, TESTDRAWCASES);
+    
+    free (columnofs);
+    free (ylookup);
+    ylookup = saveylookup;
+    columnofs = savecolumnofs;
+    centery = savecentery;
+    
+    free (colormap);
+    free (source);
+    free (screen);
+}
+
+#endif
+
+
+//
+// R_InitDrawFuncs
+// Selects the fastest high detail drawers
+//  supported by the processor, unless -nosimd.
+//
+void		(*fastcolfunc) (void) = R_DrawColumn;
+void		(*fastspanfunc) (void) = R_DrawSpan;
+
+void R_InitDrawFuncs (void)
+{
+    const char*	name;
+
+    name = "C";
+    fastcolfunc = R_DrawColumn;
+    fastspanfunc = R_DrawSpan;
+
+#ifdef SIMD_X86
+    __builtin_cpu_init ();
+
+    if (g_simdtest)
+    {
+	if (__builtin_cpu_supports ("sse2"))
+	    R_TestDrawFuncs ("SSE2", R_DrawColumnSSE2, R_DrawSpanSSE2);
+    }
+    
+    if (g_simd && __builtin_cpu_supports ("sse2"))
+    {
+	name = "SSE2";
+	fastcolfunc = R_DrawColumnSSE2;
+	fastspanfunc = R_DrawSpanSSE2;
+    }
+#else
+    if (g_simdtest)
+	I_Print ("R_TestDrawFuncs: no vectorized drawers on this target");
+#endif
+
+    I_Debug ("R_InitDrawFuncs: %s drawers", name);
+}
+
+
+
+//
+// Multithreaded refresh.
+// With -rthreads, the column and span drawing
+//  is not done straight away but recorded,
+//  and the command list is replayed by a pool
+//  of threads, each one owning a vertical slice
+//  of the view window. Each thread replays the
+//  whole list in order, clipped to its slice,
+//  so the frame is identical to a serial one.
+// The BSP traversal, clipping, visplanes and
+//  sprite sorting stay on the calling thread:
+//  wall scale steps and sprite clipping depend
+//  on the full extent of every seg, so they can
+//  not be split without changing the output.
+//
+#define MAXDRAWCMDS		4096
+
+typedef struct
+{
+    void		(*func) (void);
+    boolean		span;
+    int			x1;
+    int			x2;
+    int			y1;
+    int			y2;
+    lighttable_t*	colormap;
+    byte*		source;
+    byte*		translation;
+    fixed_t		xfrac;
+    fixed_t		yfrac;
+    fixed_t		xstep;
+    fixed_t		ystep;
+    int			fuzzpos;
+
+} drawcmd_t;
+
+// The span state saved across a flush.
+typedef struct
+{
+    int			y;
+    int			x1;
+    int			x2;
+    lighttable_t*	colormap;
+    byte*		source;
+    fixed_t		xfrac;
+    fixed_t		yfrac;
+    fixed_t		xstep;
+    fixed_t		ystep;
+
+} span_t;
+
+static drawcmd_t*	drawcmds;
+static int		numdrawcmds;
+
+// The drawers selected by R_ExecuteSetViewSize.
+static void		(*drawcolfunc) (void);
+static void		(*drawfuzzcolfunc) (void);
+static void		(*drawtranscolfunc) (void);
+static void		(*drawspanfunc) (void);
+
+
+//
+// R_NewDrawCommand
+// Flushes the list when it is full.
+//
+static drawcmd_t* R_NewDrawCommand (void (*func) (void))
+{
+    drawcmd_t*	cmd;
+    
+    if (numdrawcmds == MAXDRAWCMDS)
+	R_FlushDrawCommands ();
+
+    cmd = &drawcmds[numdrawcmds++];
+    cmd->func = func;
+    return cmd;
+}
+
+
+//
+// R_RecordColumn
+// Column commands are only replayed by the
+//  thread owning dc_x.
+//
+static void R_RecordColumn (void (*func) (void))
+{
+    drawcmd_t*	cmd;
+
+    // Zero length, nothing to draw.
+    if (dc_yh < dc_yl)
+	return;
+
+    cmd = R_NewDrawCommand (func);
+    cmd->span = false;
+    cmd->x1 = cmd->x2 = dc_x;
+    cmd->y1 = dc_yl;
+    cmd->y2 = dc_yh;
+    cmd->colormap = dc_colormap;
+    cmd->source = dc_source;
+    cmd->translation = dc_translation;
+    cmd->yfrac = dc_texturemid;
+    cmd->ystep = dc_iscale;
+    cmd->fuzzpos = fuzzpos;
+}
+
+static void R_RecordDrawColumn (void)
+{
+    R_RecordColumn (drawcolfunc);
+}
+
+static void R_RecordTranslatedColumn (void)
+{
+    R_RecordColumn (drawtranscolfunc);
+}
+
+
+//
+// R_RecordFuzzColumn
+// The fuzz table position carries over from
+//  one column to the next, so it is advanced
+//  here as R_DrawFuzzColumn would have done.
+//
+static void R_RecordFuzzColumn (void)
+{
+    if (!dc_yl) 
+	dc_yl = 1;
+
+    if (dc_yh == viewheight-1) 
+	dc_yh = viewheight - 2; 
+
+    if (dc_yh < dc_yl)
+	return;
+
+    R_RecordColumn (drawfuzzcolfunc);
+    fuzzpos = (fuzzpos + dc_yh - dc_yl + 1) % FUZZTABLE;
+}
+
+
+//
+// R_RecordSpan
+// Span commands are split between threads,
+//  see R_DrawSlice.
+//
+static void R_RecordSpan (void)
+{
+    drawcmd_t*	cmd;
+
+    cmd = R_NewDrawCommand (drawspanfunc);
+    cmd->span = true;
+    cmd->x1 = ds_x1;
+    cmd->x2 = ds_x2;
+    cmd->y1 = cmd->y2 = ds_y;
+    cmd->colormap = ds_colormap;
+    cmd->source = ds_source;
+    cmd->xfrac = ds_xfrac;
+    cmd->yfrac = ds_yfrac;
+    cmd->xstep = ds_xstep;
+    cmd->ystep = ds_ystep;
+}
+
+
+//
+// R_DrawSlice
+// Replays the commands for one vertical slice.
+// Clipped spans start further in the texture,
+//  which is exact in fixed point.
+//
+static void R_DrawSlice (void* data, int index, int count)
+{
+    drawcmd_t*	cmd;
+    drawcmd_t*	end;
+    int		sx1;
+    int		sx2;
+    int		x1;
+    int		x2;
+    unsigned	skip;
+
+    sx1 = (viewwidth*index)/count;
+    sx2 = (viewwidth*(index+1))/count - 1;
+
+    end = drawcmds + numdrawcmds;
+    for (cmd = drawcmds ; cmd < end ; cmd++)
+    {
+	x1 = cmd->x1 < sx1 ? sx1 : cmd->x1;
+	x2 = cmd->x2 > sx2 ? sx2 : cmd->x2;
+	if (x1 > x2)
+	    continue;
+
+	if (cmd->span)
+	{
+	    skip = x1 - cmd->x1;
+	    ds_y = cmd->y1;
+	    ds_x1 = x1;
+	    ds_x2 = x2;
+	    ds_colormap = cmd->colormap;
+	    ds_source = cmd->source;
+	    ds_xfrac = (unsigned)cmd->xfrac + skip*(unsigned)cmd->xstep;
+	    ds_yfrac = (unsigned)cmd->yfrac + skip*(unsigned)cmd->ystep;
+	    ds_xstep = cmd->xstep;
+	    ds_ystep = cmd->ystep;
+	}
+	else
+	{
+	    dc_x = x1;
+	    dc_yl = cmd->y1;
+	    dc_yh = cmd->y2;
+	    dc_colormap = cmd->colormap;
+	    dc_source = cmd->source;
+	    dc_translation = cmd->translation;
+	    dc_texturemid = cmd->yfrac;
+	    dc_iscale = cmd->ystep;
+	    fuzzpos = cmd->fuzzpos;
+	}
+	cmd->func ();
+    }
+}
+
+
+//
+// R_FlushDrawCommands
+// Draws everything recorded so far.
+// Must be called before the recorded sources
+//  can go away, hence the zone purge hook.
+//
+void R_FlushDrawCommands (void)
+{
+    lighttable_t*	colormap;
+    int			x;
+    int			yl;
+    int			yh;
+    fixed_t		iscale;
+    fixed_t		texturemid;
+    byte*		source;
+    byte*		translation;
+    int			fuzz;
+    span_t		span;
+    
+    if (!numdrawcmds)
+	return;
+
+    // The calling thread replays a slice too,
+    //  keep its drawing state. A full list is
+    //  flushed while a column or span is recorded.
+    span.y = ds_y;
+    span.x1 = ds_x1;
+    span.x2 = ds_x2;
+    span.colormap = ds_colormap;
+    span.source = ds_source;
+    span.xfrac = ds_xfrac;
+    span.yfrac = ds_yfrac;
+    span.xstep = ds_xstep;
+    span.ystep = ds_ystep;
+    colormap = dc_colormap;
+    x = dc_x;
+    yl = dc_yl;
+    yh = dc_yh;
+    iscale = dc_iscale;
+    texturemid = dc_texturemid;
+    source = dc_source;
+    translation = dc_translation;
+    fuzz = fuzzpos;
+
+    I_RunThreads (R_DrawSlice, NULL);
+    numdrawcmds = 0;
+
+    dc_colormap = colormap;
+    dc_x = x;
+    dc_yl = yl;
+    dc_yh = yh;
+    dc_iscale = iscale;
+    dc_texturemid = texturemid;
+    dc_source = source;
+    dc_translation = translation;
+    fuzzpos = fuzz;
+    ds_y = span.y;
+    ds_x1 = span.x1;
+    ds_x2 = span.x2;
+    ds_colormap = span.colormap;
+    ds_source = span.source;
+    ds_xfrac = span.xfrac;
+    ds_yfrac = span.yfrac;
+    ds_xstep = span.xstep;
+    ds_ystep = span.ystep;
+}
+
+
+//
+// R_InitDrawThreads
+// -rthreads 0 uses one thread per processor.
+//
+void R_InitDrawThreads (void)
+{
+    int		count;
+
+    count = g_rthreads ? g_rthreads : I_GetNumProcessors ();
+    I_InitThreads (count);
+    
+    if (I_GetNumThreads () > 1)
+    {
+	drawcmds = Z_Malloc (MAXDRAWCMDS*sizeof(*drawcmds), PU_STATIC, 0);
+	numdrawcmds = 0;
+	zonepurgefunc = R_FlushDrawCommands;
+    }
+}
+
+
+//
+// R_DeferDrawFuncs
+// Called by R_ExecuteSetViewSize once the drawers
+//  are selected. The low detail drawers write
+//  outside of their column or span, so they
+//  are kept serial.
+//
+void R_DeferDrawFuncs (void)
+{
+    if (!drawcmds || detailshift)
+	return;
+
+    drawcolfunc = basecolfunc;
+    drawfuzzcolfunc = fuzzcolfunc;
+    drawtranscolfunc = transcolfunc;
+    drawspanfunc = spanfunc;
+
+    colfunc = basecolfunc = R_RecordDrawColumn;
+    fuzzcolfunc = R_RecordFuzzColumn;
+    transcolfunc = R_RecordTranslatedColumn;
+    spanfunc = R_RecordSpan;
+}
+
+
+
 //
 // R_InitBuffer 
 // Creats lookup tables that avoid
@@ -695,6 +1374,16 @@ R_InitBuffer
 { 
     int		i; 
 
+    // The render resolution may have changed too.
+    free (ylookup);
+    free (columnofs);
+    ylookup = malloc (SCREENHEIGHT*sizeof(*ylookup));
+    columnofs = malloc (SCREENWIDTH*sizeof(*columnofs));
+
+    if (!ylookup || !columnofs)
+	I_Error ("R_InitBuffer: couldn't allocate the tables for %ix%i",
+		 SCREENWIDTH, SCREENHEIGHT);
+
     // Handle resize,
     //  e.g. smaller view windows
     //  with border and/or status bar.
@@ -727,9 +1416,12 @@ R_InitBuffer
 void R_FillBackScreen (void) 
 { 
     byte*	src;
-    byte*	dest; 
     int		x;
     int		y; 
+    int		windowx;
+    int		windowy;
+    int		windowwidth;
+    int		windowheight;
     patch_t*	patch;
 
     // DOOM border patch.
@@ -740,7 +1432,7 @@ void R_FillBackScreen (void)
 
     char*	name;
 	
-    if (scaledviewwidth == 320)
+    if (scaledviewwidth == SCREENWIDTH)
 	return;
 	
     if ( gamemode == commercial)
@@ -749,59 +1441,50 @@ void R_FillBackScreen (void)
 	name = name1;
     
     src = W_CacheLumpName (name, PU_CACHE); 
-    dest = screens[1]; 
-	 
-    for (y=0 ; y<SCREENHEIGHT-SBARHEIGHT ; y++) 
-    { 
-	for (x=0 ; x<SCREENWIDTH/64 ; x++) 
-	{ 
-	    memcpy (dest, src+((y&63)<<6), 64); 
-	    dest += 64; 
-	} 
-
-	if (SCREENWIDTH&63) 
-	{ 
-	    memcpy (dest, src+((y&63)<<6), SCREENWIDTH&63); 
-	    dest += (SCREENWIDTH&63); 
-	} 
-    } 
+    V_FillFlat (1, SCREENHEIGHT-SBARHEIGHT, src);
+
+    // The border patches are laid out in 320x200 coordinates.
+    windowx = UNSCALEX(viewwindowx);
+    windowy = UNSCALEY(viewwindowy);
+    windowwidth = UNSCALEX(scaledviewwidth);
+    windowheight = UNSCALEY(viewheight);
 	
     patch = W_CacheLumpName ("brdr_t",PU_CACHE);
 
-    for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch (viewwindowx+x,viewwindowy-8,1,patch);
+    for (x=0 ; x<windowwidth ; x+=8)
+	V_DrawPatch (windowx+x,windowy-8,1,patch);
     patch = W_CacheLumpName ("brdr_b",PU_CACHE);
 
-    for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch (viewwindowx+x,viewwindowy+viewheight,1,patch);
+    for (x=0 ; x<windowwidth ; x+=8)
+	V_DrawPatch (windowx+x,windowy+windowheight,1,patch);
     patch = W_CacheLumpName ("brdr_l",PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
-	V_DrawPatch (viewwindowx-8,viewwindowy+y,1,patch);
+    for (y=0 ; y<windowheight ; y+=8)
+	V_DrawPatch (windowx-8,windowy+y,1,patch);
     patch = W_CacheLumpName ("brdr_r",PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
-	V_DrawPatch (viewwindowx+scaledviewwidth,viewwindowy+y,1,patch);
+    for (y=0 ; y<windowheight ; y+=8)
+	V_DrawPatch (windowx+windowwidth,windowy+y,1,patch);
 
 
     // Draw beveled edge. 
-    V_DrawPatch (viewwindowx-8,
-		 viewwindowy-8,
+    V_DrawPatch (windowx-8,
+		 windowy-8,
 		 1,
 		 W_CacheLumpName ("brdr_tl",PU_CACHE));
     
-    V_DrawPatch (viewwindowx+scaledviewwidth,
-		 viewwindowy-8,
+    V_DrawPatch (windowx+windowwidth,
+		 windowy-8,
 		 1,
 		 W_CacheLumpName ("brdr_tr",PU_CACHE));
     
-    V_DrawPatch (viewwindowx-8,
-		 viewwindowy+viewheight,
+    V_DrawPatch (windowx-8,
+		 windowy+windowheight,
 		 1,
 		 W_CacheLumpName ("brdr_bl",PU_CACHE));
     
-    V_DrawPatch (viewwindowx+scaledviewwidth,
-		 viewwindowy+viewheight,
+    V_DrawPatch (windowx+windowwidth,
+		 windowy+windowheight,
 		 1,
 		 W_CacheLumpName ("brdr_br",PU_CACHE));
 } 
@@ -23,21 +23,22 @@
 #ifndef __R_DRAW__
 #define __R_DRAW__
 
+#include "i_thread.h"
 
 #ifdef __GNUG__
 #pragma interface
 #endif
 
 
-extern lighttable_t*	dc_colormap;
-extern int		dc_x;
-extern int		dc_yl;
-extern int		dc_yh;
-extern fixed_t		dc_iscale;
-extern fixed_t		dc_texturemid;
+extern I_THREAD_LOCAL lighttable_t*	dc_colormap;
+extern I_THREAD_LOCAL int		dc_x;
+extern I_THREAD_LOCAL int		dc_yl;
+extern I_THREAD_LOCAL int		dc_yh;
+extern I_THREAD_LOCAL fixed_t		dc_iscale;
+extern I_THREAD_LOCAL fixed_t		dc_texturemid;
 
 // first pixel in a column
-extern byte*		dc_source;		
+extern I_THREAD_LOCAL byte*		dc_source;		
 
 
 // The span blitting interface.
@@ -61,22 +62,22 @@ R_VideoErase
 ( unsigned	ofs,
   int		count );
 
-extern int		ds_y;
-extern int		ds_x1;
-extern int		ds_x2;
+extern I_THREAD_LOCAL int		ds_y;
+extern I_THREAD_LOCAL int		ds_x1;
+extern I_THREAD_LOCAL int		ds_x2;
 
-extern lighttable_t*	ds_colormap;
+extern I_THREAD_LOCAL lighttable_t*	ds_colormap;
 
-extern fixed_t		ds_xfrac;
-extern fixed_t		ds_yfrac;
-extern fixed_t		ds_xstep;
-extern fixed_t		ds_ystep;
+extern I_THREAD_LOCAL fixed_t		ds_xfrac;
+extern I_THREAD_LOCAL fixed_t		ds_yfrac;
+extern I_THREAD_LOCAL fixed_t		ds_xstep;
+extern I_THREAD_LOCAL fixed_t		ds_ystep;
 
 // start of a 64*64 tile image
-extern byte*		ds_source;		
+extern I_THREAD_LOCAL byte*		ds_source;		
 
 extern byte*		translationtables;
-extern byte*		dc_translation;
+extern I_THREAD_LOCAL byte*		dc_translation;
 
 
 // Span blitting for rows, floor/ceiling.
@@ -99,6 +100,19 @@ void	R_InitTranslationTables (void);
 
 
 
+// Vectorized high detail drawers, if supported.
+extern void	(*fastcolfunc) (void);
+extern void	(*fastspanfunc) (void);
+
+void	R_InitDrawFuncs (void);
+
+
+// Multithreaded refresh, see R_FlushDrawCommands.
+void	R_InitDrawThreads (void);
+void	R_DeferDrawFuncs (void);
+void	R_FlushDrawCommands (void);
+
+
 // Rendering function.
 void R_FillBackScreen (void);
 
@@ -35,6 +35,7 @@
 #include "r_local.h"
 #include "r_sky.h"
 #include "i_system.h"
+#include "m_profile.h"
 
 
 
@@ -96,7 +97,8 @@ int			viewangletox[FINEANGLES/2];
 // The xtoviewangleangle[] table maps a screen pixel
 // to the lowest viewangle that maps back to x ranges
 // from clipangle to -clipangle.
-angle_t			xtoviewangle[SCREENWIDTH+1];
+// SCREENWIDTH+1 entries, see R_InitTextureMapping.
+angle_t*		xtoviewangle;
 
 
 // UNUSED.
@@ -113,6 +115,9 @@ lighttable_t*		scalelight[LIGHTLEVELS][MAXLIGHTSCALE];
 lighttable_t*		scalelightfixed[MAXLIGHTSCALE];
 lighttable_t*		zlight[LIGHTLEVELS][MAXLIGHTZ];
 
+// scales the light index down to 320 wide
+fixed_t			lightscalemul = FRACUNIT;
+
 // bumped light from gun blasts
 int			extralight;			
 
@@ -543,6 +548,13 @@ void R_InitTextureMapping (void)
     int			x;
     int			t;
     fixed_t		focallength;
+
+    free (xtoviewangle);
+    xtoviewangle = malloc ((SCREENWIDTH+1)*sizeof(*xtoviewangle));
+
+    if (!xtoviewangle)
+	I_Error ("R_InitTextureMapping: couldn't allocate %i angles",
+		 SCREENWIDTH+1);
     
     // Use tangent table to generate viewangletox:
     //  viewangletox will give the next greatest x
@@ -622,7 +634,7 @@ void R_InitLightTables (void)
 	startmap = ((LIGHTLEVELS-1-i)*2)*NUMCOLORMAPS/LIGHTLEVELS;
 	for (j=0 ; j<MAXLIGHTZ ; j++)
 	{
-	    scale = FixedDiv ((SCREENWIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
+	    scale = FixedDiv ((ORIGWIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
 	    scale >>= LIGHTSCALESHIFT;
 	    level = startmap - scale/DISTMAP;
 	    
@@ -682,8 +694,8 @@ void R_ExecuteSetViewSize (void)
     }
     else
     {
-	scaledviewwidth = setblocks*32;
-	viewheight = (setblocks*168/10)&~7;
+	scaledviewwidth = SCALEX(setblocks*32);
+	viewheight = SCALEY((setblocks*168/10)&~7);
     }
     
     detailshift = setdetail;
@@ -697,10 +709,10 @@ void R_ExecuteSetViewSize (void)
 
     if (!detailshift)
     {
-	colfunc = basecolfunc = R_DrawColumn;
+	colfunc = basecolfunc = fastcolfunc;
 	fuzzcolfunc = R_DrawFuzzColumn;
 	transcolfunc = R_DrawTranslatedColumn;
-	spanfunc = R_DrawSpan;
+	spanfunc = fastspanfunc;
     }
     else
     {
@@ -710,15 +722,22 @@ void R_ExecuteSetViewSize (void)
 	spanfunc = R_DrawSpanLow;
     }
 
+    // Multithreaded refresh records the drawing.
+    R_DeferDrawFuncs ();
+
     R_InitBuffer (scaledviewwidth, viewheight);
 	
     R_InitTextureMapping ();
     
     // psprite scales
-    pspritescale = FRACUNIT*viewwidth/SCREENWIDTH;
-    pspriteiscale = FRACUNIT*SCREENWIDTH/viewwidth;
+    pspritescale = FRACUNIT*viewwidth/ORIGWIDTH;
+    pspriteiscale = FRACUNIT*ORIGWIDTH/viewwidth;
+
+    // light scales are indexed as in 320x200
+    lightscalemul = FRACUNIT*ORIGWIDTH/SCREENWIDTH;
     
     // thing clipping
+    R_InitClipArrays ();
     for (i=0 ; i<viewwidth ; i++)
 	screenheightarray[i] = viewheight;
     
@@ -768,8 +787,6 @@ extern int	screenblocks;
 
 void R_Init (void)
 {
-    R_InitData ();
-    I_Debug ("R_InitData");
     R_InitPointToAngle ();
     I_Debug ("R_InitPointToAngle");
     R_InitTables ();
@@ -785,6 +802,10 @@ void R_Init (void)
     I_Debug ("R_InitSkyMap");
     R_InitTranslationTables ();
     I_Debug ("R_InitTranslationsTables");
+    R_InitDrawFuncs ();
+    I_Debug ("R_InitDrawFuncs");
+    R_InitDrawThreads ();
+    I_Debug ("R_InitDrawThreads");
 	
     framecount = 0;
 }
@@ -877,17 +898,34 @@ void R_RenderPlayerView (player_t* player)
     NetUpdate ();
 
     // The head node is the last node output.
+    PROF_BEGIN (prof_bsp);
     R_RenderBSPNode (numnodes-1);
+    PROF_END (prof_bsp);
+    PROF_COUNT (prof_visplanes, numvisplanes);
+    PROF_COUNT (prof_vissprites, vissprite_p - vissprites);
+    PROF_COUNT (prof_drawsegs, ds_p - drawsegs);
     
     // Check for new console commands.
     NetUpdate ();
     
+    PROF_BEGIN (prof_planes);
     R_DrawPlanes ();
+    PROF_END (prof_planes);
     
     // Check for new console commands.
     NetUpdate ();
     
+    PROF_BEGIN (prof_masked);
     R_DrawMasked ();
+    PROF_END (prof_masked);
+
+    // Finish the deferred drawing, if any.
+    // With -rthreads, the planes and masked
+    //  phases only record the drawing,
+    //  but for the flushes of a full list.
+    PROF_BEGIN (prof_draw);
+    R_FlushDrawCommands ();
+    PROF_END (prof_draw);
 
     // Check for new console commands.
     NetUpdate ();				
@@ -34,6 +34,7 @@
 
 #include "r_local.h"
 #include "r_sky.h"
+#include "m_profile.h"
 
 
 
@@ -45,15 +46,32 @@ planefunction_t		ceilingfunc;
 //
 
 // Here comes the obnoxious "visplane".
+// The visplanes are allocated from a pool that grows
+//  by doubling, MAXVISPLANES is only its initial size.
+// Each one keeps its address, the floor and ceiling
+//  planes are held across the pool growth.
+// R_FindPlane looks them up in a hash table on
+//  (height, picnum, lightlevel).
 #define MAXVISPLANES	128
-visplane_t		visplanes[MAXVISPLANES];
-visplane_t*		lastvisplane;
+#define VISPLANEHASHSIZE	256
+#define VISPLANEHASH(height,picnum,lightlevel) \
+    ((((unsigned)(height)>>FRACBITS)*7 + (unsigned)(picnum)*3 \
+      + (unsigned)(lightlevel)) & (VISPLANEHASHSIZE-1))
+
+visplane_t**		visplanes;
+int			numvisplanes;
+int			maxvisplanes;
+visplane_t*		visplanehash[VISPLANEHASHSIZE];
 visplane_t*		floorplane;
 visplane_t*		ceilingplane;
 
-// ?
-#define MAXOPENINGS	SCREENWIDTH*64
-short			openings[MAXOPENINGS];
+// The openings are allocated from blocks of MAXOPENINGS,
+//  chained as needed, since the drawsegs point into them.
+#define MAXOPENINGS	(SCREENWIDTH*64)
+short**			openingblocks;
+int			numopeningblocks;
+int			openingblock;
+short*			openings;
 short*			lastopening;
 
 
@@ -61,16 +79,18 @@ short*			lastopening;
 // Clip values are the solid pixel bounding the range.
 //  floorclip starts out SCREENHEIGHT
 //  ceilingclip starts out -1
+// The per column and per row tables are allocated
+//  by R_InitPlanes from the render resolution.
 //
-short			floorclip[SCREENWIDTH];
-short			ceilingclip[SCREENWIDTH];
+short*			floorclip;
+short*			ceilingclip;
 
 //
 // spanstart holds the start of a plane span
 // initialized to 0 at start
 //
-int			spanstart[SCREENHEIGHT];
-int			spanstop[SCREENHEIGHT];
+int*			spanstart;
+int*			spanstop;
 
 //
 // texture mapping
@@ -78,28 +98,154 @@ int			spanstop[SCREENHEIGHT];
 lighttable_t**		planezlight;
 fixed_t			planeheight;
 
-fixed_t			yslope[SCREENHEIGHT];
-fixed_t			distscale[SCREENWIDTH];
+fixed_t*		yslope;
+fixed_t*		distscale;
 fixed_t			basexscale;
 fixed_t			baseyscale;
 
-fixed_t			cachedheight[SCREENHEIGHT];
-fixed_t			cacheddistance[SCREENHEIGHT];
-fixed_t			cachedxstep[SCREENHEIGHT];
-fixed_t			cachedystep[SCREENHEIGHT];
+fixed_t*		cachedheight;
+fixed_t*		cacheddistance;
+fixed_t*		cachedxstep;
+fixed_t*		cachedystep;
 
 
 
 //
 // R_InitPlanes
-// Only at game startup.
+// At game startup and when the render resolution changes,
+//  the visplane columns, the openings and the clip,
+//  span and slope tables depend on it.
 //
 void R_InitPlanes (void)
 {
-  // Doh!
+    int		i;
+
+    free (floorclip);
+    free (spanstart);
+    free (yslope);
+    free (distscale);
+
+    floorclip = malloc (2*SCREENWIDTH*sizeof(*floorclip));
+    spanstart = malloc (2*SCREENHEIGHT*sizeof(*spanstart));
+    yslope = malloc (5*SCREENHEIGHT*sizeof(*yslope));
+    distscale = malloc (SCREENWIDTH*sizeof(*distscale));
+
+    if (!floorclip || !spanstart || !yslope || !distscale)
+	I_Error ("R_InitPlanes: couldn't allocate the tables for %ix%i",
+		 SCREENWIDTH, SCREENHEIGHT);
+
+    ceilingclip = floorclip + SCREENWIDTH;
+    spanstop = spanstart + SCREENHEIGHT;
+    cachedheight = yslope + SCREENHEIGHT;
+    cacheddistance = cachedheight + SCREENHEIGHT;
+    cachedxstep = cacheddistance + SCREENHEIGHT;
+    cachedystep = cachedxstep + SCREENHEIGHT;
+
+    for (i=0 ; i<maxvisplanes ; i++)
+	free (visplanes[i]);
+    for (i=0 ; i<numopeningblocks ; i++)
+	free (openingblocks[i]);
+
+    free (visplanes);
+    free (openingblocks);
+    visplanes = NULL;
+    openingblocks = NULL;
+    numvisplanes = maxvisplanes = 0;
+    numopeningblocks = 0;
+    memset (visplanehash, 0, sizeof(visplanehash));
+
+    openingblock = -1;
+    openings = lastopening = NULL;
+}
+
+
+
+//
+// R_NewPlane
+// Takes the next visplane from the pool.
+//
+static visplane_t* R_NewPlane (void)
+{
+    visplane_t*	pl;
+    int		newmax;
+    int		i;
+
+    if (numvisplanes == maxvisplanes)
+    {
+	newmax = maxvisplanes ? maxvisplanes*2 : MAXVISPLANES;
+	visplanes = realloc (visplanes, newmax*sizeof(*visplanes));
+
+	if (!visplanes)
+	    I_Error ("R_NewPlane: couldn't allocate %i visplanes", newmax);
+
+	for (i=maxvisplanes ; i<newmax ; i++)
+	{
+	    // two padded rows of columns,
+	    //  unused bottoms must stay below the 0xffff tops
+	    pl = calloc (1, sizeof(*pl)
+			 + 2*(SCREENWIDTH+2)*sizeof(*pl->top));
+	    
+	    if (!pl)
+		I_Error ("R_NewPlane: couldn't allocate %i visplanes",
+			 newmax);
+	    
+	    pl->top = (unsigned short*)(pl+1) + 1;
+	    pl->bottom = pl->top + SCREENWIDTH+2;
+	    visplanes[i] = pl;
+	}
+	
+	maxvisplanes = newmax;
+	I_Debug ("R_NewPlane: %i visplanes", maxvisplanes);
+    }
+
+    return visplanes[numvisplanes++];
 }
 
 
+
+//
+// R_NewOpenings
+// Returns count free openings.
+// A new block is started when the current one is full,
+//  count never exceeds SCREENWIDTH.
+//
+short* R_NewOpenings (int count)
+{
+    short*	opening;
+
+    if (!openings || lastopening + count > openings + MAXOPENINGS)
+    {
+	if (++openingblock == numopeningblocks)
+	{
+	    openingblocks = realloc (openingblocks,
+				     (numopeningblocks+1)*sizeof(*openingblocks));
+	    
+	    if (!openingblocks)
+		I_Error ("R_NewOpenings: couldn't allocate %i openings",
+			 (numopeningblocks+1)*MAXOPENINGS);
+	    
+	    openingblocks[numopeningblocks] =
+		malloc (MAXOPENINGS*sizeof(**openingblocks));
+	    
+	    if (!openingblocks[numopeningblocks])
+		I_Error ("R_NewOpenings: couldn't allocate %i openings",
+			 (numopeningblocks+1)*MAXOPENINGS);
+
+	    numopeningblocks++;
+	}
+	
+	openings = openingblocks[openingblock];
+	lastopening = openings;
+    }
+
+    opening = lastopening;
+    lastopening += count;
+    
+    return opening;
+}
+
+
+
 //
 // R_MapPlane
 //
@@ -171,6 +317,7 @@ R_MapPlane
 
     // high or low detail
     spanfunc ();	
+    PROF_COUNT (prof_spans, 1);
 }
 
 
@@ -190,11 +337,15 @@ void R_ClearPlanes (void)
 	ceilingclip[i] = -1;
     }
 
-    lastvisplane = visplanes;
-    lastopening = openings;
+    numvisplanes = 0;
+    memset (visplanehash, 0, sizeof(visplanehash));
+
+    // the first block is allocated on demand
+    openingblock = -1;
+    openings = lastopening = NULL;
     
     // texture calculation
-    memset (cachedheight, 0, sizeof(cachedheight));
+    memset (cachedheight, 0, viewheight*sizeof(*cachedheight));
 
     // left to right mapping
     angle = (viewangle-ANG90)>>ANGLETOFINESHIFT;
@@ -217,31 +368,32 @@ R_FindPlane
   int		lightlevel )
 {
     visplane_t*	check;
+    unsigned	hash;
 	
     if (picnum == skyflatnum)
     {
 	height = 0;			// all skys map together
 	lightlevel = 0;
     }
-	
-    for (check=visplanes; check<lastvisplane; check++)
+
+    // Only the planes made here are hashed,
+    //  those split by R_CheckPlane come later in
+    //  the pool and were never found first.
+    hash = VISPLANEHASH(height, picnum, lightlevel);
+    
+    for (check=visplanehash[hash]; check; check=check->next)
     {
 	if (height == check->height
 	    && picnum == check->picnum
 	    && lightlevel == check->lightlevel)
 	{
-	    break;
+	    return check;
 	}
     }
     
-			
-    if (check < lastvisplane)
-	return check;
-		
-    if (lastvisplane - visplanes == MAXVISPLANES)
-	I_Error ("R_FindPlane: no more visplanes");
-		
-    lastvisplane++;
+    check = R_NewPlane ();
+    check->next = visplanehash[hash];
+    visplanehash[hash] = check;
 
     check->height = height;
     check->picnum = picnum;
@@ -249,7 +401,7 @@ R_FindPlane
     check->minx = SCREENWIDTH;
     check->maxx = -1;
     
-    memset (check->top,0xff,sizeof(check->top));
+    memset (check->top,0xff,SCREENWIDTH*sizeof(*check->top));
 		
     return check;
 }
@@ -269,6 +421,7 @@ R_CheckPlane
     int		unionl;
     int		unionh;
     int		x;
+    visplane_t*	check;
 	
     if (start < pl->minx)
     {
@@ -293,7 +446,7 @@ R_CheckPlane
     }
 
     for (x=intrl ; x<= intrh ; x++)
-	if (pl->top[x] != 0xff)
+	if (pl->top[x] != 0xffff)
 	    break;
 
     if (x > intrh)
@@ -306,15 +459,16 @@ R_CheckPlane
     }
 	
     // make a new visplane
-    lastvisplane->height = pl->height;
-    lastvisplane->picnum = pl->picnum;
-    lastvisplane->lightlevel = pl->lightlevel;
+    check = R_NewPlane ();
+    check->height = pl->height;
+    check->picnum = pl->picnum;
+    check->lightlevel = pl->lightlevel;
     
-    pl = lastvisplane++;
+    pl = check;
     pl->minx = start;
     pl->maxx = stop;
 
-    memset (pl->top,0xff,sizeof(pl->top));
+    memset (pl->top,0xff,SCREENWIDTH*sizeof(*pl->top));
 		
     return pl;
 }
@@ -363,27 +517,16 @@ R_MakeSpans
 void R_DrawPlanes (void)
 {
     visplane_t*		pl;
+    int			i;
     int			light;
     int			x;
     int			stop;
     int			angle;
 				
-#ifdef RANGECHECK
-    if (ds_p - drawsegs > MAXDRAWSEGS)
-	I_Error ("R_DrawPlanes: drawsegs overflow (%i)",
-		 ds_p - drawsegs);
-    
-    if (lastvisplane - visplanes > MAXVISPLANES)
-	I_Error ("R_DrawPlanes: visplane overflow (%i)",
-		 lastvisplane - visplanes);
-    
-    if (lastopening - openings > MAXOPENINGS)
-	I_Error ("R_DrawPlanes: opening overflow (%i)",
-		 lastopening - openings);
-#endif
-
-    for (pl = visplanes ; pl < lastvisplane ; pl++)
+    for (i=0 ; i<numvisplanes ; i++)
     {
+	pl = visplanes[i];
+	
 	if (pl->minx > pl->maxx)
 	    continue;
 
@@ -410,6 +553,7 @@ void R_DrawPlanes (void)
 		    dc_x = x;
 		    dc_source = R_GetColumn(skytexture, angle);
 		    colfunc ();
+		    PROF_COUNT (prof_columns, 1);
 		}
 	    }
 	    continue;
@@ -431,8 +575,8 @@ void R_DrawPlanes (void)
 
 	planezlight = zlight[light];
 
-	pl->top[pl->maxx+1] = 0xff;
-	pl->top[pl->minx-1] = 0xff;
+	pl->top[pl->maxx+1] = 0xffff;
+	pl->top[pl->minx-1] = 0xffff;
 		
 	stop = pl->maxx + 1;
 
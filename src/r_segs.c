@@ -30,6 +30,7 @@
 
 #include "r_local.h"
 #include "r_sky.h"
+#include "m_profile.h"
 
 
 // OPTIMIZE: closed two sided lines as single sided
@@ -158,7 +159,7 @@ R_RenderMaskedSegRange
 	{
 	    if (!fixedcolormap)
 	    {
-		index = spryscale>>LIGHTSCALESHIFT;
+		index = FixedMul(spryscale,lightscalemul)>>LIGHTSCALESHIFT;
 
 		if (index >=  MAXLIGHTSCALE )
 		    index = MAXLIGHTSCALE-1;
@@ -258,7 +259,7 @@ void R_RenderSegLoop (void)
 	    texturecolumn = rw_offset-FixedMul(finetangent[angle],rw_distance);
 	    texturecolumn >>= FRACBITS;
 	    // calculate lighting
-	    index = rw_scale>>LIGHTSCALESHIFT;
+	    index = FixedMul(rw_scale,lightscalemul)>>LIGHTSCALESHIFT;
 
 	    if (index >=  MAXLIGHTSCALE )
 		index = MAXLIGHTSCALE-1;
@@ -277,6 +278,7 @@ void R_RenderSegLoop (void)
 	    dc_texturemid = rw_midtexturemid;
 	    dc_source = R_GetColumn(midtexture,texturecolumn);
 	    colfunc ();
+	    PROF_COUNT (prof_columns, 1);
 	    ceilingclip[rw_x] = viewheight;
 	    floorclip[rw_x] = -1;
 	}
@@ -299,6 +301,7 @@ void R_RenderSegLoop (void)
 		    dc_texturemid = rw_toptexturemid;
 		    dc_source = R_GetColumn(toptexture,texturecolumn);
 		    colfunc ();
+		    PROF_COUNT (prof_columns, 1);
 		    ceilingclip[rw_x] = mid;
 		}
 		else
@@ -329,6 +332,7 @@ void R_RenderSegLoop (void)
 		    dc_source = R_GetColumn(bottomtexture,
 					    texturecolumn);
 		    colfunc ();
+		    PROF_COUNT (prof_columns, 1);
 		    floorclip[rw_x] = mid;
 		}
 		else
@@ -374,9 +378,8 @@ R_StoreWallRange
     fixed_t		vtop;
     int			lightnum;
 
-    // don't overflow and crash
-    if (ds_p == &drawsegs[MAXDRAWSEGS])
-	return;		
+    // grow instead of overflowing
+    R_NewDrawSeg ();
 		
 #ifdef RANGECHECK
     if (start >=viewwidth || start > stop)
@@ -600,8 +603,8 @@ R_StoreWallRange
 	{
 	    // masked midtexture
 	    maskedtexture = true;
-	    ds_p->maskedtexturecol = maskedtexturecol = lastopening - rw_x;
-	    lastopening += rw_stopx - rw_x;
+	    ds_p->maskedtexturecol = maskedtexturecol =
+		R_NewOpenings (rw_stopx - rw_x) - rw_x;
 	}
     }
     
@@ -710,17 +713,15 @@ R_StoreWallRange
     if ( ((ds_p->silhouette & SIL_TOP) || maskedtexture)
 	 && !ds_p->sprtopclip)
     {
-	memcpy (lastopening, ceilingclip+start, 2*(rw_stopx-start));
-	ds_p->sprtopclip = lastopening - start;
-	lastopening += rw_stopx - start;
+	ds_p->sprtopclip = R_NewOpenings (rw_stopx - start) - start;
+	memcpy (ds_p->sprtopclip+start, ceilingclip+start, 2*(rw_stopx-start));
     }
     
     if ( ((ds_p->silhouette & SIL_BOTTOM) || maskedtexture)
 	 && !ds_p->sprbottomclip)
     {
-	memcpy (lastopening, floorclip+start, 2*(rw_stopx-start));
-	ds_p->sprbottomclip = lastopening - start;
-	lastopening += rw_stopx - start;	
+	ds_p->sprbottomclip = R_NewOpenings (rw_stopx - start) - start;
+	memcpy (ds_p->sprbottomclip+start, floorclip+start, 2*(rw_stopx-start));
     }
 
     if (maskedtexture && !(ds_p->silhouette&SIL_TOP))
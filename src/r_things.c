@@ -35,6 +35,7 @@
 #include "r_local.h"
 
 #include "doomstat.h"
+#include "m_profile.h"
 
 
 
@@ -73,8 +74,12 @@ lighttable_t**	spritelights;
 
 // constant arrays
 //  used for psprite clipping and initializing clipping
-short		negonearray[SCREENWIDTH];
-short		screenheightarray[SCREENWIDTH];
+short*		negonearray;
+short*		screenheightarray;
+
+// The sprite clipping of R_DrawSprite.
+static short*	clipbot;
+static short*	cliptop;
 
 
 //
@@ -217,7 +222,7 @@ void R_InitSpriteDefs (char** namelist)
 		rotation = lumpinfo[l].name[5] - '0';
 
 		if (modifiedgame)
-		    patched = W_GetNumForName (lumpinfo[l].name);
+		    patched = W_GetNumForNameNS (lumpinfo[l].name, ns_sprites);
 		else
 		    patched = l;
 
@@ -281,8 +286,10 @@ void R_InitSpriteDefs (char** namelist)
 //
 // GAME FUNCTIONS
 //
-vissprite_t	vissprites[MAXVISSPRITES];
+// Grows by doubling, MAXVISSPRITES is only its initial size.
+vissprite_t*	vissprites;
 vissprite_t*	vissprite_p;
+int		maxvissprites;
 
 
 
@@ -291,15 +298,63 @@ vissprite_t*	vissprite_p;
 // Called at program start.
 //
 void R_InitSprites (char** namelist)
+{
+    if (!R_CachedSpriteDefs (namelist))
+    {
+	R_InitSpriteDefs (namelist);
+	R_WriteDataCache (namelist);
+    }
+}
+
+
+//
+// R_InitClipArrays
+// At game startup and when the render resolution changes.
+//
+void R_InitClipArrays (void)
 {
     int		i;
-	
+
+    free (negonearray);
+    negonearray = malloc (4*SCREENWIDTH*sizeof(*negonearray));
+
+    if (!negonearray)
+	I_Error ("R_InitClipArrays: couldn't allocate %i columns",
+		 SCREENWIDTH);
+
+    screenheightarray = negonearray + SCREENWIDTH;
+    clipbot = screenheightarray + SCREENWIDTH;
+    cliptop = clipbot + SCREENWIDTH;
+
     for (i=0 ; i<SCREENWIDTH ; i++)
-    {
 	negonearray[i] = -1;
+}
+
+
+
+//
+// R_PrefetchSprite
+// Reads ahead every frame of a sprite,
+//  from a W_StartPrefetch task.
+//
+void R_PrefetchSprite (int sprite)
+{
+    spritedef_t*	sprdef;
+    int			i;
+    int			j;
+
+    if (sprite < 0 || sprite >= numsprites)
+	return;
+
+    sprdef = &sprites[sprite];
+    for (i=0 ; i<sprdef->numframes ; i++)
+    {
+	for (j=0 ; j<8 ; j++)
+	{
+	    if (sprdef->spriteframes[i].lump[j] >= 0)
+		W_PrefetchLump (firstspritelump + sprdef->spriteframes[i].lump[j]);
+	}
     }
-	
-    R_InitSpriteDefs (namelist);
 }
 
 
@@ -316,13 +371,26 @@ void R_ClearSprites (void)
 
 //
 // R_NewVisSprite
+// No vissprite is held across the calls,
+//  they can be moved when growing.
 //
-vissprite_t	overflowsprite;
-
 vissprite_t* R_NewVisSprite (void)
 {
-    if (vissprite_p == &vissprites[MAXVISSPRITES])
-	return &overflowsprite;
+    int		numvissprites;
+    
+    if (vissprite_p == vissprites + maxvissprites)
+    {
+	numvissprites = vissprite_p - vissprites;
+	maxvissprites = maxvissprites ? maxvissprites*2 : MAXVISSPRITES;
+	vissprites = realloc (vissprites, maxvissprites*sizeof(*vissprites));
+
+	if (!vissprites)
+	    I_Error ("R_NewVisSprite: couldn't allocate %i vissprites",
+		     maxvissprites);
+	
+	vissprite_p = vissprites + numvissprites;
+	I_Debug ("R_NewVisSprite: %i vissprites", maxvissprites);
+    }
     
     vissprite_p++;
     return vissprite_p-1;
@@ -374,6 +442,7 @@ void R_DrawMaskedColumn (column_t* column)
 	    // Drawn by either R_DrawColumn
 	    //  or (SHADOW) R_DrawFuzzColumn.
 	    colfunc ();	
+	    PROF_COUNT (prof_columns, 1);
 	}
 	column = (column_t *)(  (byte *)column + column->length + 4);
     }
@@ -410,7 +479,7 @@ R_DrawVisSprite
     }
     else if (vis->mobjflags & MF_TRANSLATION)
     {
-	colfunc = R_DrawTranslatedColumn;
+	colfunc = transcolfunc;
 	dc_translation = translationtables - 256 +
 	    ( (vis->mobjflags & MF_TRANSLATION) >> (MF_TRANSSHIFT-8) );
     }
@@ -588,7 +657,7 @@ void R_ProjectSprite (mobj_t* thing)
     else
     {
 	// diminished light
-	index = xscale>>(LIGHTSCALESHIFT-detailshift);
+	index = FixedMul(xscale,lightscalemul)>>(LIGHTSCALESHIFT-detailshift);
 
 	if (index >= MAXLIGHTSCALE) 
 	    index = MAXLIGHTSCALE-1;
@@ -774,57 +843,85 @@ void R_DrawPlayerSprites (void)
 
 //
 // R_SortVisSprites
+// Bottom-up merge sort on scale, back to front.
+// It is stable, sprites of equal scale keep
+//  the order in which they were projected.
 //
 vissprite_t	vsprsortedhead;
 
+static vissprite_t**	vsprsort;
+static vissprite_t**	vsprmerge;
+static int		maxvsprsort;
+
 
 void R_SortVisSprites (void)
 {
     int			i;
     int			count;
+    int			width;
+    int			left;
+    int			mid;
+    int			right;
+    int			l;
+    int			r;
+    vissprite_t**	src;
+    vissprite_t**	dst;
+    vissprite_t**	swap;
     vissprite_t*	ds;
-    vissprite_t*	best;
-    static vissprite_t		unsorted;
-    fixed_t		bestscale;
 
     count = vissprite_p - vissprites;
 	
-    unsorted.next = unsorted.prev = &unsorted;
+    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
 
     if (!count)
 	return;
-		
-    for (ds=vissprites ; ds<vissprite_p ; ds++)
+
+    if (count > maxvsprsort)
     {
-	ds->next = ds+1;
-	ds->prev = ds-1;
+	maxvsprsort = maxvissprites;
+	vsprsort = realloc (vsprsort, maxvsprsort*sizeof(*vsprsort));
+	vsprmerge = realloc (vsprmerge, maxvsprsort*sizeof(*vsprmerge));
+
+	if (!vsprsort || !vsprmerge)
+	    I_Error ("R_SortVisSprites: couldn't sort %i vissprites", count);
     }
-    
-    vissprites[0].prev = &unsorted;
-    unsorted.next = &vissprites[0];
-    (vissprite_p-1)->next = &unsorted;
-    unsorted.prev = vissprite_p-1;
-    
-    // pull the vissprites out by scale
-    best = NULL;		// shut up the compiler warning
-    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
+		
     for (i=0 ; i<count ; i++)
+	vsprsort[i] = &vissprites[i];
+
+    src = vsprsort;
+    dst = vsprmerge;
+    
+    for (width=1 ; width<count ; width*=2)
     {
-	bestscale = MAXINT;
-	for (ds=unsorted.next ; ds!= &unsorted ; ds=ds->next)
+	for (left=0 ; left<count ; left+=width*2)
 	{
-	    if (ds->scale < bestscale)
+	    mid = left+width < count ? left+width : count;
+	    right = mid+width < count ? mid+width : count;
+
+	    // take from the left run on equal scales
+	    for (i=left, l=left, r=mid ; i<right ; i++)
 	    {
-		bestscale = ds->scale;
-		best = ds;
+		if (l < mid
+		    && (r >= right || src[l]->scale <= src[r]->scale))
+		    dst[i] = src[l++];
+		else
+		    dst[i] = src[r++];
 	    }
 	}
-	best->next->prev = best->prev;
-	best->prev->next = best->next;
-	best->next = &vsprsortedhead;
-	best->prev = vsprsortedhead.prev;
-	vsprsortedhead.prev->next = best;
-	vsprsortedhead.prev = best;
+	swap = src;
+	src = dst;
+	dst = swap;
+    }
+    
+    // link them from the smallest scale
+    for (i=0 ; i<count ; i++)
+    {
+	ds = src[i];
+	ds->next = &vsprsortedhead;
+	ds->prev = vsprsortedhead.prev;
+	vsprsortedhead.prev->next = ds;
+	vsprsortedhead.prev = ds;
     }
 }
 
@@ -836,8 +933,6 @@ void R_SortVisSprites (void)
 void R_DrawSprite (vissprite_t* spr)
 {
     drawseg_t*		ds;
-    short		clipbot[SCREENWIDTH];
-    short		cliptop[SCREENWIDTH];
     int			x;
     int			r1;
     int			r2;
@@ -30,14 +30,15 @@
 
 #define MAXVISSPRITES  	128
 
-extern vissprite_t	vissprites[MAXVISSPRITES];
+extern vissprite_t*	vissprites;
 extern vissprite_t*	vissprite_p;
 extern vissprite_t	vsprsortedhead;
 
 // Constant arrays used for psprite clipping
 //  and initializing clipping.
-extern short		negonearray[SCREENWIDTH];
-extern short		screenheightarray[SCREENWIDTH];
+// SCREENWIDTH long, see R_InitClipArrays.
+extern short*		negonearray;
+extern short*		screenheightarray;
 
 // vars for R_DrawMaskedColumn
 extern short*		mfloorclip;
@@ -58,6 +59,8 @@ void R_AddSprites (sector_t* sec);
 void R_AddPSprites (void);
 void R_DrawSprites (void);
 void R_InitSprites (char** namelist);
+void R_InitClipArrays (void);
+void R_PrefetchSprite (int sprite);
 void R_ClearSprites (void);
 void R_DrawMasked (void);
 
@@ -165,12 +165,12 @@ V_CopyRect
 	 
 #ifdef RANGECHECK 
     if (srcx<0
-	||srcx+width >SCREENWIDTH
+	||srcx+width >ORIGWIDTH
 	|| srcy<0
-	|| srcy+height>SCREENHEIGHT 
-	||destx<0||destx+width >SCREENWIDTH
+	|| srcy+height>ORIGHEIGHT 
+	||destx<0||destx+width >ORIGWIDTH
 	|| desty<0
-	|| desty+height>SCREENHEIGHT 
+	|| desty+height>ORIGHEIGHT 
 	|| (unsigned)srcscrn>4
 	|| (unsigned)destscrn>4)
     {
@@ -178,9 +178,13 @@ V_CopyRect
     }
 #endif 
     V_MarkRect (destx, desty, width, height); 
+
+    // the rectangle is given in 320x200 coordinates
+    width = SCALEX(destx+width) - SCALEX(destx);
+    height = SCALEY(desty+height) - SCALEY(desty);
 	 
-    src = screens[srcscrn]+SCREENWIDTH*srcy+srcx; 
-    dest = screens[destscrn]+SCREENWIDTH*desty+destx; 
+    src = screens[srcscrn]+SCREENWIDTH*SCALEY(srcy)+SCALEX(srcx); 
+    dest = screens[destscrn]+SCREENWIDTH*SCALEY(desty)+SCALEX(destx); 
 
     for ( ; height>0 ; height--) 
     { 
@@ -191,6 +195,93 @@ V_CopyRect
 } 
  
 
+//
+// V_DrawColumn
+// Masks a patch column to the screen.
+// The column origin is given in 320x200 coordinates,
+//  each source pixel covers a scaled block of the screen.
+//
+void
+V_DrawColumn
+( int		x,
+  int		y,
+  int		scrn,
+  column_t*	column ) 
+{ 
+    int		count;
+    int		width;
+    int		top;
+    int		dy;
+    int		dy2;
+    byte*	dest;
+    byte*	source; 
+
+    width = SCALEX(x+1) - SCALEX(x);
+
+    // step through the posts in a column 
+    while (column->topdelta != 0xff ) 
+    { 
+	source = (byte *)column + 3; 
+	top = y + column->topdelta;
+	dy = SCALEY(top);
+	dest = screens[scrn] + dy*SCREENWIDTH + SCALEX(x); 
+	count = column->length; 
+			 
+	while (count--) 
+	{ 
+	    for (dy2 = SCALEY(++top) ; dy<dy2 ; dy++)
+	    {
+		memset (dest, *source, width);
+		dest += SCREENWIDTH; 
+	    }
+	    source++;
+	} 
+	column = (column_t *)(  (byte *)column + column->length 
+				+ 4 ); 
+    } 
+} 
+
+
+//
+// V_FillFlat
+// Tiles a 64x64 flat over the top rows of a screen,
+//  the flat is scaled like the 320x200 graphics.
+//
+void
+V_FillFlat
+( int		scrn,
+  int		height,
+  byte*		src ) 
+{ 
+    int		x;
+    int		y;
+    int		lx;
+    int		frac;
+    byte*	dest;
+    byte*	row;
+
+    dest = screens[scrn];
+
+    for (y=0 ; y<height ; y++) 
+    { 
+	row = src + ((UNSCALEY(y)&63)<<6);
+
+	// step through the flat with an exact
+	//  integer DDA, lx = x*ORIGWIDTH/SCREENWIDTH
+	for (x=0, lx=0, frac=0 ; x<SCREENWIDTH ; x++)
+	{
+	    *dest++ = row[lx&63];
+	    frac += ORIGWIDTH;
+	    while (frac >= SCREENWIDTH)
+	    {
+		frac -= SCREENWIDTH;
+		lx++;
+	    }
+	}
+    } 
+} 
+ 
+
 //
 // V_DrawPatch
 // Masks a column based masked pic to the screen. 
@@ -203,21 +294,17 @@ V_DrawPatch
   patch_t*	patch ) 
 { 
 
-    int		count;
     int		col; 
     column_t*	column; 
-    byte*	desttop;
-    byte*	dest;
-    byte*	source; 
     int		w; 
 	 
     y -= SHORT(patch->topoffset); 
     x -= SHORT(patch->leftoffset); 
 #ifdef RANGECHECK 
     if (x<0
-	||x+SHORT(patch->width) >SCREENWIDTH
+	||x+SHORT(patch->width) >ORIGWIDTH
 	|| y<0
-	|| y+SHORT(patch->height)>SCREENHEIGHT 
+	|| y+SHORT(patch->height)>ORIGHEIGHT 
 	|| (unsigned)scrn>4)
     {
       I_Alert("Patch at %d,%d exceeds LFB", x,y );
@@ -230,30 +317,12 @@ V_DrawPatch
     if (!scrn)
 	V_MarkRect (x, y, SHORT(patch->width), SHORT(patch->height)); 
 
-    col = 0; 
-    desttop = screens[scrn]+y*SCREENWIDTH+x; 
-	 
     w = SHORT(patch->width); 
 
-    for ( ; col<w ; x++, col++, desttop++)
+    for (col=0 ; col<w ; x++, col++)
     { 
 	column = (column_t *)((byte *)patch + LONG(patch->columnofs[col])); 
- 
-	// step through the posts in a column 
-	while (column->topdelta != 0xff ) 
-	{ 
-	    source = (byte *)column + 3; 
-	    dest = desttop + column->topdelta*SCREENWIDTH; 
-	    count = column->length; 
-			 
-	    while (count--) 
-	    { 
-		*dest = *source++; 
-		dest += SCREENWIDTH; 
-	    } 
-	    column = (column_t *)(  (byte *)column + column->length 
-				    + 4 ); 
-	} 
+	V_DrawColumn (x, y, scrn, column);
     }			 
 } 
  
@@ -270,21 +339,17 @@ V_DrawPatchFlipped
   patch_t*	patch ) 
 { 
 
-    int		count;
     int		col; 
     column_t*	column; 
-    byte*	desttop;
-    byte*	dest;
-    byte*	source; 
     int		w; 
 	 
     y -= SHORT(patch->topoffset); 
     x -= SHORT(patch->leftoffset); 
 #ifdef RANGECHECK 
     if (x<0
-	||x+SHORT(patch->width) >SCREENWIDTH
+	||x+SHORT(patch->width) >ORIGWIDTH
 	|| y<0
-	|| y+SHORT(patch->height)>SCREENHEIGHT 
+	|| y+SHORT(patch->height)>ORIGHEIGHT 
 	|| (unsigned)scrn>4)
     {
       I_Alert("Patch origin %d,%d exceeds LFB", x,y);
@@ -295,30 +360,12 @@ V_DrawPatchFlipped
     if (!scrn)
 	V_MarkRect (x, y, SHORT(patch->width), SHORT(patch->height)); 
 
-    col = 0; 
-    desttop = screens[scrn]+y*SCREENWIDTH+x; 
-	 
     w = SHORT(patch->width); 
 
-    for ( ; col<w ; x++, col++, desttop++) 
+    for (col=0 ; col<w ; x++, col++)
     { 
 	column = (column_t *)((byte *)patch + LONG(patch->columnofs[w-1-col])); 
- 
-	// step through the posts in a column 
-	while (column->topdelta != 0xff ) 
-	{ 
-	    source = (byte *)column + 3; 
-	    dest = desttop + column->topdelta*SCREENWIDTH; 
-	    count = column->length; 
-			 
-	    while (count--) 
-	    { 
-		*dest = *source++; 
-		dest += SCREENWIDTH; 
-	    } 
-	    column = (column_t *)(  (byte *)column + column->length 
-				    + 4 ); 
-	} 
+	V_DrawColumn (x, y, scrn, column);
     }			 
 } 
  
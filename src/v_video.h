@@ -82,6 +82,21 @@ V_DrawPatchDirect
   int		scrn,
   patch_t*	patch );
 
+// Masks a patch column, origin in 320x200 coordinates.
+void
+V_DrawColumn
+( int		x,
+  int		y,
+  int		scrn,
+  column_t*	column );
+
+// Tiles a 64x64 flat over the top rows of a screen.
+void
+V_FillFlat
+( int		scrn,
+  int		height,
+  byte*		src );
+
 
 // Draw a linear block of pixels into the view buffer.
 void
@@ -24,6 +24,7 @@
 #ifdef NORMALUNIX
 #include <ctype.h>
 #include <sys/types.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <malloc.h>
@@ -33,11 +34,17 @@
 #define O_BINARY		0
 #endif
 
+#if defined(NORMALUNIX) && !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#define WADMMAP
+#endif
+
 #include "doomdef.h"
 #include "doomtype.h"
 #include "m_swap.h"
 #include "i_system.h"
 #include "z_zone.h"
+#include "m_misc.h"
 
 #ifdef __GNUG__
 #pragma implementation "w_wad.h"
@@ -59,6 +66,48 @@ int			numlumps;
 
 void**			lumpcache;
 
+// Hash chains over the lump names, the last
+//  lump first, so that later files override.
+static int*		lumphash;
+static int*		lumpnext;
+static byte*		lumpns;
+static unsigned		lumphashmask;
+
+// The lumps read into the zone, most recently
+//  used first, and what happened to every lump.
+typedef struct
+{
+    int		prev;		// -2 if not in the list
+    int		next;
+    int		accesses;
+    int		loads;
+    int		evictions;
+
+} lumpstat_t;
+
+static lumpstat_t*	lumpstats;
+static int		lruhead = -1;
+static int		lrutail = -1;
+static int		lrubytes;
+static int		lrupeak;
+
+static int		lumphits;
+static int		lumpmisses;
+static int		lumpevictions;
+static int		lumppurges;	// thrown out by the zone
+
+// Lumps read ahead by a background task,
+//  until W_ReadLump takes them.
+static byte**		lumpprefetch;
+static byte*		lumpfetched;
+static boolean		prefetching;
+static int		prefetchcount;
+static int		prefetchbytes;
+static volatile byte	prefetchsink;
+
+// The files added, their sizes and modification times.
+static uint64_t		wadkey = M_HASHSEED;
+
 
 #define strcmpi	strcasecmp
 
@@ -112,6 +161,38 @@ ExtractFileBase
 
 
 
+//
+// W_MapFile
+// Maps a whole file read only, NULL if it can't.
+// The pages are shared with any other process
+//  mapping the same file.
+//
+static byte* W_MapFile (int handle, int length)
+{
+#ifdef WADMMAP
+    void*	base;
+
+    if (!g_mmap || length <= 0)
+	return NULL;
+
+    base = mmap (NULL, length, PROT_READ, MAP_SHARED, handle, 0);
+    if (base == MAP_FAILED)
+	return NULL;
+
+    // lumps used in place are not zone blocks
+    if (!Z_AddExternal (base, length))
+    {
+	munmap (base, length);
+	return NULL;
+    }
+    return (byte *)base;
+#else
+    return NULL;
+#endif
+}
+
+
+
 
 //
 // LUMP BASED ROUTINES.
@@ -134,6 +215,24 @@ int			reloadlump;
 char*			reloadname;
 
 
+//
+// W_KeyFile
+//
+static void W_KeyFile (char* filename, int handle)
+{
+    struct stat	fileinfo;
+    int64_t	times[2];
+
+    wadkey = M_HashBytes (wadkey, filename, strlen (filename)+1);
+    if (fstat (handle, &fileinfo) == -1)
+	return;
+
+    times[0] = fileinfo.st_size;
+    times[1] = fileinfo.st_mtime;
+    wadkey = M_HashBytes (wadkey, times, sizeof(times));
+}
+
+
 void W_AddFile (char *filename)
 {
     wadinfo_t		header;
@@ -146,6 +245,8 @@ void W_AddFile (char *filename)
     filelump_t		singleinfo;
     int			storehandle;
     int			rc;
+    byte*		filemap;
+    int			filesize;
     
     // open the file and add to directory
 
@@ -165,6 +266,8 @@ void W_AddFile (char *filename)
 
     I_Debug (" adding %s",filename);
     startlump = numlumps;
+
+    W_KeyFile (filename, handle);
 	
     if (strcmpi (filename+strlen(filename)-3 , "wad" ) )
     {
@@ -212,6 +315,10 @@ void W_AddFile (char *filename)
     lump_p = &lumpinfo[startlump];
 	
     storehandle = reloadname ? -1 : handle;
+
+    // a reloadable file is read again on each reload
+    filesize = filelength (handle);
+    filemap = reloadname ? NULL : W_MapFile (handle, filesize);
 	
     for (i=startlump ; i<numlumps ; i++,lump_p++, fileinfo++)
     {
@@ -219,6 +326,12 @@ void W_AddFile (char *filename)
 	lump_p->position = LONG(fileinfo->filepos);
 	lump_p->size = LONG(fileinfo->size);
 	strncpy (lump_p->name, fileinfo->name, 8);
+
+	lump_p->mapped = NULL;
+	if (filemap
+	    && lump_p->position >= 0 && lump_p->size >= 0
+	    && lump_p->position <= filesize - lump_p->size)
+	    lump_p->mapped = filemap + lump_p->position;
     }
 	
     if (reloadname)
@@ -280,6 +393,118 @@ void W_Reload (void)
 
 
 
+//
+// W_NameKey
+// Makes a lump name into two integers for easy compares.
+//
+static void
+W_NameKey
+( char*		name,
+  int*		v1,
+  int*		v2 )
+{
+    union {
+	char	s[9];
+	int	x[2];
+	
+    } name8;
+
+    strncpy (name8.s,name,8);
+
+    // in case the name was a fill 8 chars
+    name8.s[8] = 0;
+
+    // case insensitive
+    my_strupr (name8.s);		
+
+    *v1 = name8.x[0];
+    *v2 = name8.x[1];
+}
+
+
+//
+// W_HashKey
+//
+static unsigned W_HashKey (int v1, int v2)
+{
+    unsigned	hash;
+
+    hash = (unsigned)v1 * 0x9e3779b1u;
+    hash = (hash ^ (hash >> 15) ^ (unsigned)v2) * 0x85ebca6bu;
+    return (hash ^ (hash >> 13)) & lumphashmask;
+}
+
+
+//
+// W_IsMarker
+//
+static boolean W_IsMarker (char* name, char* marker)
+{
+    return !strncasecmp (name, marker, 8);
+}
+
+
+//
+// W_HashLumps
+// Chains every lump to its name, and notes
+//  the namespace it lies in.
+//
+static void W_HashLumps (void)
+{
+    lumpinfo_t*	lump_p;
+    unsigned	hash;
+    int		size;
+    int		ns;
+    int		i;
+
+    for (size = 1 ; size < numlumps ; size <<= 1)
+	;
+    lumphashmask = size-1;
+
+    lumphash = malloc (size * sizeof(*lumphash));
+    lumpnext = malloc (numlumps * sizeof(*lumpnext));
+    lumpns = malloc (numlumps);
+
+    if (!lumphash || !lumpnext || !lumpns)
+	I_Error ("Couldn't allocate the lump hash");
+
+    memset (lumphash, -1, size * sizeof(*lumphash));
+
+    ns = ns_global;
+    for (i=0,lump_p=lumpinfo ; i<numlumps ; i++,lump_p++)
+    {
+	// the markers themselves are global
+	if (W_IsMarker (lump_p->name, "S_START")
+	    || W_IsMarker (lump_p->name, "SS_START"))
+	{
+	    ns = ns_sprites;
+	    lumpns[i] = ns_global;
+	}
+	else if (W_IsMarker (lump_p->name, "F_START")
+		 || W_IsMarker (lump_p->name, "FF_START"))
+	{
+	    ns = ns_flats;
+	    lumpns[i] = ns_global;
+	}
+	else if (W_IsMarker (lump_p->name, "S_END")
+		 || W_IsMarker (lump_p->name, "SS_END")
+		 || W_IsMarker (lump_p->name, "F_END")
+		 || W_IsMarker (lump_p->name, "FF_END"))
+	{
+	    ns = ns_global;
+	    lumpns[i] = ns_global;
+	}
+	else
+	    lumpns[i] = ns;
+
+	hash = W_HashKey (*(int *)lump_p->name, *(int *)&lump_p->name[4]);
+	lumpnext[i] = lumphash[hash];
+	lumphash[hash] = i;
+    }
+}
+
+
+
 //
 // W_InitMultipleFiles
 // Pass a null terminated list of files to use.
@@ -317,6 +542,21 @@ void W_InitMultipleFiles (char** filenames)
 	I_Error ("Couldn't allocate lumpcache");
 
     memset (lumpcache,0, size);
+
+    lumpstats = malloc (numlumps * sizeof(*lumpstats));
+    if (!lumpstats)
+	I_Error ("Couldn't allocate lumpstats");
+
+    memset (lumpstats, 0, numlumps * sizeof(*lumpstats));
+    for (size=0 ; size<numlumps ; size++)
+	lumpstats[size].prev = -2;
+
+    lumpprefetch = calloc (numlumps, sizeof(*lumpprefetch));
+    lumpfetched = calloc (numlumps, 1);
+    if (!lumpprefetch || !lumpfetched)
+	I_Error ("Couldn't allocate lumpprefetch");
+
+    W_HashLumps ();
 }
 
 
@@ -348,44 +588,32 @@ int W_NumLumps (void)
 
 
 //
-// W_CheckNumForName
-// Returns -1 if name not found.
+// W_FindLump
+// Returns the last lump of that name,
+//  in any namespace if ns is -1.
 //
-
-int W_CheckNumForName (char* name)
+static int
+W_FindLump
+( char*		name,
+  int		ns )
 {
-    union {
-	char	s[9];
-	int	x[2];
-	
-    } name8;
-    
     int		v1;
     int		v2;
+    int		i;
     lumpinfo_t*	lump_p;
 
-    // make the name into two integers for easy compares
-    strncpy (name8.s,name,8);
-
-    // in case the name was a fill 8 chars
-    name8.s[8] = 0;
-
-    // case insensitive
-    my_strupr (name8.s);		
-
-    v1 = name8.x[0];
-    v2 = name8.x[1];
+    W_NameKey (name, &v1, &v2);
 
-
-    // scan backwards so patch lump files take precedence
-    lump_p = lumpinfo + numlumps;
-
-    while (lump_p-- != lumpinfo)
+    // the chain starts with the last lump,
+    //  so patch lump files take precedence
+    for (i = lumphash[W_HashKey (v1, v2)] ; i != -1 ; i = lumpnext[i])
     {
+	lump_p = &lumpinfo[i];
 	if ( *(int *)lump_p->name == v1
-	     && *(int *)&lump_p->name[4] == v2)
+	     && *(int *)&lump_p->name[4] == v2
+	     && (ns == -1 || lumpns[i] == ns))
 	{
-	    return lump_p - lumpinfo;
+	    return i;
 	}
     }
 
@@ -394,6 +622,29 @@ int W_CheckNumForName (char* name)
 }
 
 
+//
+// W_CheckNumForName
+// Returns -1 if name not found.
+//
+int W_CheckNumForName (char* name)
+{
+    return W_FindLump (name, -1);
+}
+
+
+//
+// W_CheckNumForNameNS
+// Returns -1 if name not found in the namespace.
+//
+int
+W_CheckNumForNameNS
+( char*		name,
+  lumpns_t	ns )
+{
+    return W_FindLump (name, ns);
+}
+
+
 
 
 //
@@ -413,6 +664,25 @@ int W_GetNumForName (char* name)
 }
 
 
+//
+// W_GetNumForNameNS
+//
+int
+W_GetNumForNameNS
+( char*		name,
+  lumpns_t	ns )
+{
+    int	i;
+
+    i = W_FindLump (name, ns);
+    
+    if (i == -1)
+      I_Error ("W_GetNumForNameNS: %s not found!", name);
+      
+    return i;
+}
+
+
 //
 // W_LumpLength
 // Returns the buffer size needed to load the given lump.
@@ -428,12 +698,10 @@ int W_LumpLength (int lump)
 
 
 //
-// W_ReadLump
-// Loads the lump into the given buffer,
-//  which must be >= W_LumpLength().
+// W_ReadLumpData
 //
-void
-W_ReadLump
+static void
+W_ReadLumpData
 ( int		lump,
   void*		dest )
 {
@@ -445,6 +713,22 @@ W_ReadLump
 	I_Error ("W_ReadLump: %i >= numlumps",lump);
 
     l = lumpinfo+lump;
+
+    if (l->mapped)
+    {
+	memcpy (dest, l->mapped, l->size);
+	return;
+    }
+
+    // read ahead, once the task is done,
+    //  the slots are its own until then
+    if (!prefetching && lumpprefetch[lump])
+    {
+	memcpy (dest, lumpprefetch[lump], l->size);
+	free (lumpprefetch[lump]);
+	lumpprefetch[lump] = NULL;
+	return;
+    }
 	
     // ??? I_BeginRead ();
 	
@@ -472,12 +756,143 @@ W_ReadLump
 
 
 
+//
+// W_ReadLump
+// Loads the lump into the given buffer,
+//  which must be >= W_LumpLength().
+// Serialized while the zone is shared.
+//
+void
+W_ReadLump
+( int		lump,
+  void*		dest )
+{
+    if (!zoneshared)
+    {
+	W_ReadLumpData (lump, dest);
+	return;
+    }
+    I_Lock ();
+    W_ReadLumpData (lump, dest);
+    I_Unlock ();
+}
+
+
 
 //
-// W_CacheLumpNum
+// LUMP CACHE
 //
-void*
-W_CacheLumpNum
+
+//
+// W_LinkLRU
+// Puts a lump at the head of the list.
+//
+static void W_LinkLRU (int lump)
+{
+    lumpstats[lump].prev = -1;
+    lumpstats[lump].next = lruhead;
+    if (lruhead != -1)
+	lumpstats[lruhead].prev = lump;
+    else
+	lrutail = lump;
+    lruhead = lump;
+
+    lrubytes += lumpinfo[lump].size;
+    if (lrubytes > lrupeak)
+	lrupeak = lrubytes;
+}
+
+
+//
+// W_UnlinkLRU
+//
+static void W_UnlinkLRU (int lump)
+{
+    lumpstat_t*	stat;
+
+    stat = &lumpstats[lump];
+    if (stat->prev >= 0)
+	lumpstats[stat->prev].next = stat->next;
+    else
+	lruhead = stat->next;
+
+    if (stat->next >= 0)
+	lumpstats[stat->next].prev = stat->prev;
+    else
+	lrutail = stat->prev;
+
+    stat->prev = -2;
+    lrubytes -= lumpinfo[lump].size;
+}
+
+
+//
+// W_ForgetPurged
+// Takes out of the list the lumps
+//  the zone has thrown out.
+//
+static void W_ForgetPurged (void)
+{
+    int		lump;
+    int		next;
+
+    for (lump = lruhead ; lump != -1 ; lump = next)
+    {
+	next = lumpstats[lump].next;
+	if (!lumpcache[lump])
+	{
+	    W_UnlinkLRU (lump);
+	    lumppurges++;
+	}
+    }
+}
+
+
+//
+// W_EvictLumps
+// Throws out the least recently used purgable
+//  lumps, until no more than budget bytes are
+//  cached. The lumps in use stay.
+//
+static void W_EvictLumps (int budget)
+{
+    memblock_t*	block;
+    int		lump;
+    int		prev;
+
+    for (lump = lrutail ; lump != -1 && lrubytes > budget ; lump = prev)
+    {
+	prev = lumpstats[lump].prev;
+
+	if (!lumpcache[lump])
+	{
+	    W_UnlinkLRU (lump);
+	    lumppurges++;
+	    continue;
+	}
+
+	block = (memblock_t *) ( (byte *)lumpcache[lump] - sizeof(memblock_t));
+	if (block->tag < PU_PURGELEVEL)
+	    continue;
+
+	// let deferred users finish with it first,
+	//  as when the zone purges it
+	if (zonepurgefunc)
+	    zonepurgefunc ();
+
+	W_UnlinkLRU (lump);
+	Z_Free (lumpcache[lump]);
+	lumpstats[lump].evictions++;
+	lumpevictions++;
+    }
+}
+
+
+//
+// W_CacheLump
+//
+static void*
+W_CacheLump
 ( int		lump,
   int		tag )
 {
@@ -485,26 +900,77 @@ W_CacheLumpNum
 
     if ((unsigned)lump >= numlumps)
 	I_Error ("W_CacheLumpNum: %i >= numlumps",lump);
+
+    lumpstats[lump].accesses++;
+
+    ptr = lumpinfo[lump].mapped;
+    if (ptr && !((uintptr_t)ptr & 3))
+    {
+	lumphits++;
+	return ptr;
+    }
 		
     if (!lumpcache[lump])
     {
 	// read the lump in
+	lumpmisses++;
+	lumpstats[lump].loads++;
+
+	// purged by the zone since
+	if (lumpstats[lump].prev != -2)
+	{
+	    W_UnlinkLRU (lump);
+	    lumppurges++;
+	}
+
+	// make room within the budget first,
+	//  another thread may be using the others
+	if (g_lumpbudget && !zoneshared)
+	    W_EvictLumps (g_lumpbudget*1024 - lumpinfo[lump].size);
 	
-	//I_Alert ("cache miss on lump %i",lump);
 	ptr = Z_Malloc (W_LumpLength (lump), tag, &lumpcache[lump]);
 	IGNORE_UNUSED(ptr);
 	W_ReadLump (lump, lumpcache[lump]);
+
+	// the allocation may have purged some
+	W_ForgetPurged ();
     }
     else
     {
-	//I_Debug ("cache hit on lump %i",lump);
+	lumphits++;
 	Z_ChangeTag (lumpcache[lump],tag);
+	W_UnlinkLRU (lump);
     }
+
+    W_LinkLRU (lump);
 	
     return lumpcache[lump];
 }
 
 
+//
+// W_CacheLumpNum
+// A mapped lump is used in place, the engine never
+//  writes to the lumps it caches. It is copied only
+//  if misaligned, for the structures cast over it.
+//
+void*
+W_CacheLumpNum
+( int		lump,
+  int		tag )
+{
+    void*	ptr;
+
+    if (!zoneshared)
+	return W_CacheLump (lump, tag);
+
+    I_Lock ();
+    ptr = W_CacheLump (lump, tag);
+    I_Unlock ();
+    return ptr;
+}
+
+
 
 //
 // W_CacheLumpName
@@ -519,64 +985,237 @@ W_CacheLumpName
 
 
 //
-// W_Profile
+// READING AHEAD
 //
-int		info[2500][10];
-int		profilecount;
 
-void W_Profile (void)
+//
+// W_StartPrefetch
+//
+void
+W_StartPrefetch
+( I_TaskFunc	func,
+  void*		data )
 {
-    int		i;
-    memblock_t*	block;
-    void*	ptr;
-    char	ch;
-    FILE*	f;
-    int		j;
-    char	name[9];
-	
-	
-    for (i=0 ; i<numlumps ; i++)
-    {	
-	ptr = lumpcache[i];
-	if (!ptr)
+    W_FinishPrefetch ();
+    W_ReleasePrefetch ();
+
+    memset (lumpfetched, 0, numlumps);
+    prefetchcount = 0;
+    prefetchbytes = 0;
+    prefetching = true;
+
+    I_StartTask (func, data);
+}
+
+
+//
+// W_FinishPrefetch
+// Waits for the task, its lumps can then be read.
+//
+void W_FinishPrefetch (void)
+{
+    if (!prefetching)
+	return;
+
+    I_WaitTask ();
+    prefetching = false;
+
+    I_Debug ("W_FinishPrefetch: %i lumps, %i KB read ahead",
+	     prefetchcount, prefetchbytes / 1024);
+}
+
+
+//
+// W_ReleasePrefetch
+// Frees the lumps read ahead but not taken.
+//
+void W_ReleasePrefetch (void)
+{
+    int		lump;
+
+    if (prefetching)
+	return;
+
+    for (lump=0 ; lump<numlumps ; lump++)
+    {
+	if (lumpprefetch[lump])
 	{
-	    ch = ' ';
-	    continue;
+	    free (lumpprefetch[lump]);
+	    lumpprefetch[lump] = NULL;
 	}
-	else
+    }
+}
+
+
+//
+// W_PrefetchLump
+// The pages of a mapped lump are faulted in,
+//  other lumps are read into a buffer.
+// Called by the task only.
+//
+void W_PrefetchLump (int lump)
+{
+    lumpinfo_t*	l;
+    byte*	buffer;
+    int		i;
+
+    if ((unsigned)lump >= numlumps || lumpfetched[lump])
+	return;
+
+    lumpfetched[lump] = 1;
+    l = &lumpinfo[lump];
+    if (l->size <= 0)
+	return;
+
+    if (l->mapped)
+    {
+	for (i=0 ; i<l->size ; i+=4096)
+	    prefetchsink += ((byte *)l->mapped)[i];
+	prefetchsink += ((byte *)l->mapped)[l->size-1];
+    }
+    else
+    {
+	// reloadable lumps are read again anyway
+	if (l->handle == -1)
+	    return;
+
+	buffer = malloc (l->size);
+	if (!buffer)
+	    return;
+
+	if (pread (l->handle, buffer, l->size, l->position) != l->size)
 	{
-	    block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
-	    if (block->tag < PU_PURGELEVEL)
-		ch = 'S';
-	    else
-		ch = 'P';
+	    free (buffer);
+	    return;
 	}
-	info[i][profilecount] = ch;
+	lumpprefetch[lump] = buffer;
     }
-    profilecount++;
-	
-    f = fopen ("waddump.txt","w");
-    name[8] = 0;
 
+    prefetchcount++;
+    prefetchbytes += l->size;
+}
+
+
+//
+// W_PrefetchData
+// Returns a lump read ahead, NULL if it was not.
+// Called by the task only.
+//
+void* W_PrefetchData (int lump)
+{
+    if ((unsigned)lump >= numlumps || !lumpfetched[lump])
+	return NULL;
+
+    if (lumpinfo[lump].mapped)
+	return lumpinfo[lump].mapped;
+
+    return lumpprefetch[lump];
+}
+
+
+
+//
+// W_WadKey
+// Identifies the loaded WAD set, for the caches
+//  of what is derived from it: the files, their
+//  sizes and modification times, and the lump
+//  directory.
+//
+uint64_t W_WadKey (void)
+{
+    uint64_t	hash;
+    int		i;
+
+    hash = M_HashBytes (wadkey, &numlumps, sizeof(numlumps));
     for (i=0 ; i<numlumps ; i++)
     {
-	memcpy (name,lumpinfo[i].name,8);
+	hash = M_HashBytes (hash, lumpinfo[i].name, 8);
+	hash = M_HashBytes (hash, &lumpinfo[i].position, sizeof(lumpinfo[i].position));
+	hash = M_HashBytes (hash, &lumpinfo[i].size, sizeof(lumpinfo[i].size));
+    }
+    return hash;
+}
+
+
+
+//
+// W_Report
+// Writes the cache counters and, for every lump
+//  accessed, the accesses, loads and evictions,
+//  the most loaded lumps first.
+//
+static int W_CompareLoads (const void* a, const void* b)
+{
+    const lumpstat_t*	sa = &lumpstats[*(const int *)a];
+    const lumpstat_t*	sb = &lumpstats[*(const int *)b];
+
+    if (sa->loads != sb->loads)
+	return sb->loads - sa->loads;
+    if (sa->accesses != sb->accesses)
+	return sb->accesses - sa->accesses;
+    return *(const int *)a - *(const int *)b;
+}
 
-	for (j=0 ; j<8 ; j++)
-	    if (!name[j])
-		break;
+boolean W_Report (char* filename)
+{
+    FILE*	f;
+    memblock_t*	block;
+    int*	order;
+    int		count;
+    int		lump;
+    int		i;
+    char	name[9];
+    char*	state;
+
+    W_ForgetPurged ();
 
-	for ( ; j<8 ; j++)
-	    name[j] = ' ';
+    I_Print ("W_Report: %i hits, %i misses, %.1f%% hit rate,"
+	     " %i evicted, %i purged by the zone, %i KB cached, peak %i KB",
+	     lumphits, lumpmisses,
+	     lumphits+lumpmisses ? 100.0*lumphits/(lumphits+lumpmisses) : 0.0,
+	     lumpevictions, lumppurges, lrubytes/1024, lrupeak/1024);
 
-	fprintf (f,"%s ",name);
+    f = fopen (filename,"w");
+    if (!f)
+	return false;
 
-	for (j=0 ; j<profilecount ; j++)
-	    fprintf (f,"    %c",info[i][j]);
+    order = malloc (numlumps * sizeof(*order));
+    if (!order)
+	I_Error ("W_Report: couldn't allocate %i lumps", numlumps);
 
-	fprintf (f,"\n");
+    count = 0;
+    for (lump=0 ; lump<numlumps ; lump++)
+    {
+	if (lumpstats[lump].accesses)
+	    order[count++] = lump;
     }
-    fclose (f);
-}
+    qsort (order, count, sizeof(*order), W_CompareLoads);
 
+    fprintf (f,"lump,name,size,accesses,loads,evictions,state\n");
+    name[8] = 0;
 
+    for (i=0 ; i<count ; i++)
+    {
+	lump = order[i];
+	memcpy (name,lumpinfo[lump].name,8);
+
+	// mapped in place, static or purgable in the zone, or gone
+	if (lumpinfo[lump].mapped && !((uintptr_t)lumpinfo[lump].mapped & 3))
+	    state = "mapped";
+	else if (!lumpcache[lump])
+	    state = "none";
+	else
+	{
+	    block = (memblock_t *) ( (byte *)lumpcache[lump] - sizeof(memblock_t));
+	    state = block->tag < PU_PURGELEVEL ? "static" : "purgable";
+	}
+
+	fprintf (f,"%i,%s,%i,%i,%i,%i,%s\n",
+		 lump, name, lumpinfo[lump].size, lumpstats[lump].accesses,
+		 lumpstats[lump].loads, lumpstats[lump].evictions, state);
+    }
+
+    free (order);
+    fclose (f);
+    return true;
+}
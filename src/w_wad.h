@@ -23,6 +23,9 @@
 #ifndef __W_WAD__
 #define __W_WAD__
 
+#include "doomtype.h"
+#include "i_thread.h"
+
 
 #ifdef __GNUG__
 #pragma interface
@@ -59,9 +62,21 @@ typedef struct
     int		handle;
     int		position;
     int		size;
+    void*	mapped;		// in the mapped file, NULL if read
 } lumpinfo_t;
 
 
+// Lump namespaces, the lumps between the S_START/S_END
+//  and F_START/F_END markers (or SS_ and FF_ for PWADs).
+typedef enum
+{
+    ns_global,
+    ns_sprites,
+    ns_flats
+
+} lumpns_t;
+
+
 extern	void**		lumpcache;
 extern	lumpinfo_t*	lumpinfo;
 extern	int		numlumps;
@@ -72,12 +87,32 @@ void    W_Reload (void);
 int	W_CheckNumForName (char* name);
 int	W_GetNumForName (char* name);
 
+// Only the lumps of a namespace.
+int	W_CheckNumForNameNS (char* name, lumpns_t ns);
+int	W_GetNumForNameNS (char* name, lumpns_t ns);
+
 int	W_LumpLength (int lump);
 void    W_ReadLump (int lump, void *dest);
 
 void*	W_CacheLumpNum (int lump, int tag);
 void*	W_CacheLumpName (char* name, int tag);
 
+// Changes with the files or the lump directory.
+uint64_t W_WadKey (void);
+
+// Writes the lump cache statistics to a CSV file.
+boolean	W_Report (char* filename);
+
+// Reading ahead in a background task, e.g. the next
+//  level during the intermission. The task can only
+//  call W_PrefetchLump, W_PrefetchData and the lookups.
+// W_ReadLump takes the lumps read ahead once finished.
+void	W_StartPrefetch (I_TaskFunc func, void* data);
+void	W_FinishPrefetch (void);
+void	W_ReleasePrefetch (void);
+void	W_PrefetchLump (int lump);
+void*	W_PrefetchData (int lump);
+
 
 
 
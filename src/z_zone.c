@@ -21,8 +21,11 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <string.h>
+
 #include "z_zone.h"
 #include "i_system.h"
+#include "i_thread.h"
 #include "doomdef.h"
 
 
@@ -35,27 +38,373 @@
 //
 // It is of no value to free a cachable block,
 //  because it will get overwritten automatically if needed.
+//
+// The free blocks are also kept in size class bins,
+//  so most allocations do not walk the block list.
+// Small bins hold a single size, in steps of 8 bytes,
+//  large bins hold a power of two range of sizes.
+// The rover walk is left for purging the cachable
+//  blocks, once no free block is big enough.
+//
+// The PU_LEVEL and PU_LEVSPEC blocks without a user
+//  are carved out of chunks of a level arena instead,
+//  with a smaller header, and are all released at once
+//  by Z_FreeTags. Freed small blocks are recycled.
+//
+// Those of a pooled size, the mobjs and the special
+//  thinkers, get a cache line aligned slot of a slab
+//  pool. Freed slots are reused last in, first out.
+//
+// Once nothing more can be purged, the zone grows by
+//  a segment, up to the -zonemax cap. Every segment ends
+//  with an in use fence block, so that free blocks of
+//  two segments never merge.
+//
+// While zoneshared is set, several threads allocate:
+//  the calls are serialized, and the cachable blocks
+//  are kept, since another thread may be reading one.
+//
+// Memory outside of the zone can be handed out as if
+//  it were a block, e.g. the lumps of a mapped WAD file.
+//  Z_Free and Z_ChangeTag leave it alone.
 // 
- 
-#define ZONEID	0x1d4a11
 
+#define ZONEALIGN	8
+#define NUMSMALLBINS	128
+#define SMALLBINLIMIT	(NUMSMALLBINS*ZONEALIGN)
+#define NUMBINS		(NUMSMALLBINS+22)
+#define BINMAPWORDS	((NUMBINS+31)/32)
+
+
+// A segment added on demand, its blocks follow.
+typedef struct zsegment_s
+{
+    struct zsegment_s*	next;
+    int			size;
+
+} zsegment_t;
 
 typedef struct
 {
     // total bytes malloced, including header
     int		size;
 
+    // the first segment, and the ones added
+    int		basesize;
+    zsegment_t*	segments;
+    int		numsegments;
+
     // start / end cap for linked list
     memblock_t	blocklist;
     
     memblock_t*	rover;
+
+    // free blocks by size class, and the non-empty bins
+    memblock_t*	bins[NUMBINS];
+    unsigned	binmap[BINMAPWORDS];
     
 } memzone_t;
 
 
+// The links of a free block live in its free space.
+typedef struct
+{
+    memblock_t*	next;
+    memblock_t*	prev;
+
+} freelink_t;
+
+#define FREELINK(block)	((freelink_t *)((byte *)(block) + sizeof(memblock_t)))
+
 
 memzone_t*	mainzone;
 
+// The fence at the end of a segment.
+#define Z_FENCE(block)	((block)->user == (void **)mainzone)
+
+// Bytes in use by tag, and their peaks.
+#define NUMTAGS		(PU_CACHE+1)
+
+static int	zonetagused[NUMTAGS];
+static int	zonetagpeak[NUMTAGS];
+static int	zoneused;
+static int	zonepeak;
+
+// Set by Z_Benchmark to time the rover walk alone.
+static boolean	zonerover;
+
+
+// A chunk of the level arena, a PU_STATIC zone block.
+typedef struct arenachunk_s
+{
+    struct arenachunk_s*	next;
+    int				size;
+    int				used;
+
+} arenachunk_t;
+
+#define ARENACHUNK	(256*1024)
+#define ARENASMALL	1024	// biggest recycled block
+
+static boolean		zonearena;
+static arenachunk_t*	arenachunks;	// the current chunk first
+static int		arenasize;	// bytes carved since the reset
+static int		arenareserve;	// size of the next first chunk
+static void*		arenafree[ARENASMALL/ZONEALIGN];
+
+static void*	Z_ArenaMalloc (int size, int tag);
+static void	Z_ArenaFree (arenablock_t* block);
+static void	Z_ResetArena (void);
+static void*	Z_ZoneMalloc (int size, int tag, void* user);
+
+
+// Ranges of memory outside of the zone.
+#define MAXEXTERNAL	16
+
+static byte*	externalbase[MAXEXTERNAL];
+static byte*	externalend[MAXEXTERNAL];
+static int	numexternal;
+
+
+// A slab pool, the slabs are level blocks.
+typedef struct
+{
+    int		size;		// of the objects
+    int		slotsize;	// header included, in cache lines
+    void*	free;		// freed slots, last in first
+    byte*	slab;		// next slot of the last slab
+    byte*	slabend;
+
+} zpool_t;
+
+#define CACHELINE	64
+#define MAXPOOLS	16
+#define MAXPOOLSIZE	512
+#define POOLSLOTS	64	// per slab
+
+static zpool_t	pools[MAXPOOLS];
+static int	numpools;
+static byte	poolbysize[MAXPOOLSIZE+1];	// pool number + 1
+
+static void*	Z_PoolMalloc (zpool_t* pool, int tag);
+static void	Z_PoolFree (poolblock_t* block);
+static void	Z_ResetPools (void);
+
+void		(*zonepurgefunc) (void);
+boolean		zoneshared;
+
+
+
+//
+// Z_BinIndex
+// Returns the bin of a block size, header included.
+//
+static int Z_BinIndex (int size)
+{
+    int		bin;
+
+    if (size < SMALLBINLIMIT)
+	return size / ZONEALIGN;
+
+    bin = NUMSMALLBINS;
+    for (size /= SMALLBINLIMIT*2 ; size ; size >>= 1)
+	bin++;
+    return bin;
+}
+
+
+//
+// Z_NextBin
+// Returns the first non-empty bin from bin on, -1 if none.
+//
+static int Z_NextBin (int bin)
+{
+    unsigned	bits;
+    int		word;
+
+    if (bin >= NUMBINS)
+	return -1;
+
+    word = bin / 32;
+    bits = mainzone->binmap[word] & (~0u << (bin & 31));
+    while (!bits)
+    {
+	if (++word == BINMAPWORDS)
+	    return -1;
+	bits = mainzone->binmap[word];
+    }
+
+#ifdef __GNUC__
+    return word*32 + __builtin_ctz (bits);
+#else
+    for (bin = word*32 ; !(bits & 1) ; bits >>= 1)
+	bin++;
+    return bin;
+#endif
+}
+
+
+//
+// Z_LinkFree
+// Puts a free block at the head of its bin.
+//
+static void Z_LinkFree (memblock_t* block)
+{
+    freelink_t*	link;
+    int		bin;
+
+    bin = Z_BinIndex (block->size);
+    link = FREELINK(block);
+    link->prev = NULL;
+    link->next = mainzone->bins[bin];
+    if (link->next)
+	FREELINK(link->next)->prev = block;
+
+    mainzone->bins[bin] = block;
+    mainzone->binmap[bin/32] |= 1u << (bin & 31);
+}
+
+
+//
+// Z_UnlinkFree
+// Takes a free block out of its bin.
+//
+static void Z_UnlinkFree (memblock_t* block)
+{
+    freelink_t*	link;
+    int		bin;
+
+    link = FREELINK(block);
+    if (link->prev)
+	FREELINK(link->prev)->next = link->next;
+    else
+    {
+	bin = Z_BinIndex (block->size);
+	mainzone->bins[bin] = link->next;
+	if (!link->next)
+	    mainzone->binmap[bin/32] &= ~(1u << (bin & 31));
+    }
+
+    if (link->next)
+	FREELINK(link->next)->prev = link->prev;
+}
+
+
+//
+// Z_FindFree
+// Returns a free block of at least size bytes, NULL if none.
+// Any block of a small bin fits exactly, a large bin
+//  is searched first fit, then any bigger bin will do.
+//
+static memblock_t* Z_FindFree (int size)
+{
+    memblock_t*	block;
+    int		bin;
+
+    bin = Z_BinIndex (size);
+    if (bin >= NUMSMALLBINS)
+    {
+	for (block = mainzone->bins[bin] ; block ; block = FREELINK(block)->next)
+	{
+	    if (block->size >= size)
+		return block;
+	}
+	bin++;
+    }
+
+    bin = Z_NextBin (bin);
+    if (bin < 0)
+	return NULL;
+    return mainzone->bins[bin];
+}
+
+
+
+//
+// Z_CountTag
+// Adds to the bytes in use by a tag.
+//
+static void Z_CountTag (int tag, int size)
+{
+    zoneused += size;
+    if (zoneused > zonepeak)
+	zonepeak = zoneused;
+
+    if (tag < 0 || tag >= NUMTAGS)
+	return;
+
+    zonetagused[tag] += size;
+    if (zonetagused[tag] > zonetagpeak[tag])
+	zonetagpeak[tag] = zonetagused[tag];
+}
+
+
+//
+// Z_InitFence
+//
+static void Z_InitFence (memzone_t* zone, memblock_t* fence)
+{
+    fence->size = sizeof(memblock_t);
+    fence->user = (void **)zone;
+    fence->tag = 0;
+    fence->id = 0;
+}
+
+
+//
+// Z_AddSegment
+// Returns the free block of a new segment,
+//  big enough for size bytes.
+//
+static memblock_t* Z_AddSegment (int size)
+{
+    zsegment_t*	segment;
+    memblock_t*	block;
+    memblock_t*	fence;
+    int		segsize;
+
+    // at least as big as the first one
+    segsize = sizeof(zsegment_t) + size + sizeof(memblock_t);
+    if (segsize < mainzone->basesize)
+	segsize = mainzone->basesize;
+    segsize = (segsize + ZONEALIGN-1) & ~(ZONEALIGN-1);
+
+    segment = NULL;
+    if (!g_mb_max || (int64_t)mainzone->size + segsize <= (int64_t)g_mb_max*1024*1024)
+	segment = (zsegment_t *)I_ZoneSegment (segsize);
+    if (!segment)
+	I_Error ("Z_Malloc: failed on allocation of %i bytes", size);
+
+    segment->next = mainzone->segments;
+    segment->size = segsize;
+    mainzone->segments = segment;
+    mainzone->numsegments++;
+    mainzone->size += segsize;
+
+    block = (memblock_t *) ((byte *)segment + sizeof(zsegment_t));
+    block->size = segsize - sizeof(zsegment_t) - sizeof(memblock_t);
+    block->user = NULL;
+    block->tag = 0;
+    block->id = 0;
+
+    fence = (memblock_t *) ((byte *)block + block->size);
+    Z_InitFence (mainzone, fence);
+
+    // at the end of the block list
+    block->prev = mainzone->blocklist.prev;
+    block->next = fence;
+    fence->prev = block;
+    fence->next = &mainzone->blocklist;
+    block->prev->next = block;
+    mainzone->blocklist.prev = fence;
+
+    Z_LinkFree (block);
+
+    I_Print ("Z_Malloc: zone grown to %i KB in %i segments",
+	     mainzone->size / 1024, mainzone->numsegments);
+    return block;
+}
+
 
 
 //
@@ -64,22 +413,56 @@ memzone_t*	mainzone;
 void Z_ClearZone (memzone_t* zone)
 {
     memblock_t*		block;
+    memblock_t*		fence;
+    zsegment_t*		segment;
+
+    // give the added segments back
+    while (zone->segments)
+    {
+	segment = zone->segments;
+	zone->segments = segment->next;
+	I_ZoneRelease ((byte *)segment);
+    }
+    zone->size = zone->basesize;
+    zone->numsegments = 1;
 	
     // set the entire zone to one free block
     zone->blocklist.next =
-	zone->blocklist.prev =
 	block = (memblock_t *)( (byte *)zone + sizeof(memzone_t) );
     
     zone->blocklist.user = (void *)zone;
     zone->blocklist.tag = PU_STATIC;
     zone->rover = block;
 	
-    block->prev = block->next = &zone->blocklist;
-    
     // NULL indicates a free block.
     block->user = NULL;	
+    block->tag = 0;
+    block->id = 0;
 
-    block->size = zone->size - sizeof(memzone_t);
+    block->size = ((zone->size - sizeof(memzone_t)) & ~(ZONEALIGN-1))
+		- sizeof(memblock_t);
+
+    fence = (memblock_t *) ((byte *)block + block->size);
+    Z_InitFence (zone, fence);
+
+    block->prev = &zone->blocklist;
+    block->next = fence;
+    fence->prev = block;
+    fence->next = &zone->blocklist;
+    zone->blocklist.prev = fence;
+
+    memset (zone->bins, 0, sizeof(zone->bins));
+    memset (zone->binmap, 0, sizeof(zone->binmap));
+    Z_LinkFree (block);
+
+    memset (zonetagused, 0, sizeof(zonetagused));
+    zoneused = 0;
+
+    // the arena chunks and the slabs went with the rest
+    arenachunks = NULL;
+    arenasize = 0;
+    memset (arenafree, 0, sizeof(arenafree));
+    Z_ResetPools ();
 }
 
 
@@ -89,42 +472,58 @@ void Z_ClearZone (memzone_t* zone)
 //
 void Z_Init (void)
 {
-    memblock_t*	block;
     int		size;
 
     mainzone = (memzone_t *)I_ZoneBase (&size);
+    if (!mainzone)
+	I_Error ("Z_Init: unable to allocate a %i KB zone", size / 1024);
     mainzone->size = size;
+    mainzone->basesize = size;
+    mainzone->segments = NULL;
 
     // set the entire zone to one free block
-    mainzone->blocklist.next =
-	mainzone->blocklist.prev =
-	block = (memblock_t *)( (byte *)mainzone + sizeof(memzone_t) );
+    Z_ClearZone (mainzone);
+    zonearena = g_arena;
 
-    mainzone->blocklist.user = (void *)mainzone;
-    mainzone->blocklist.tag = PU_STATIC;
-    mainzone->rover = block;
-	
-    block->prev = block->next = &mainzone->blocklist;
-
-    // NULL indicates a free block.
-    block->user = NULL;
-    
-    block->size = mainzone->size - sizeof(memzone_t);
+    if (g_zonebench)
+    {
+	Z_Benchmark ();
+	Z_ClearZone (mainzone);
+	memset (zonetagpeak, 0, sizeof(zonetagpeak));
+	zonepeak = 0;
+    }
 }
 
 
 //
-// Z_Free
+// Z_FreeBlock
 //
-void Z_Free (void* ptr)
+static void Z_FreeBlock (void* ptr)
 {
     memblock_t*		block;
     memblock_t*		other;
+
+    if (Z_External (ptr))
+	return;
 	
+    if (Z_BLOCKID(ptr) == POOLID)
+    {
+	Z_PoolFree ((poolblock_t *)ptr - 1);
+	return;
+    }
+
+    if (Z_BLOCKID(ptr) == ARENAID)
+    {
+	Z_ArenaFree ((arenablock_t *)ptr - 1);
+	return;
+    }
+
     block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
 
     if (block->id != ZONEID)
 	I_Error ("Z_Free: freed a pointer without ZONEID");
+
+    Z_CountTag (block->tag, -block->size);
 		
     if (block->user > (void **)0x100)
     {
@@ -145,6 +544,7 @@ void Z_Free (void* ptr)
     if (!other->user)
     {
 	// merge with previous free block
+	Z_UnlinkFree (other);
 	other->size += block->size;
 	other->next = block->next;
 	other->next->prev = other;
@@ -159,6 +559,7 @@ void Z_Free (void* ptr)
     if (!other->user)
     {
 	// merge the next free block onto the end
+	Z_UnlinkFree (other);
 	block->size += other->size;
 	block->next = other->next;
 	block->next->prev = block;
@@ -166,39 +567,40 @@ void Z_Free (void* ptr)
 	if (other == mainzone->rover)
 	    mainzone->rover = block;
     }
+
+    Z_LinkFree (block);
 }
 
 
 
+
 //
-// Z_Malloc
-// You can pass a NULL user if the tag is < PU_PURGELEVEL.
+// Z_Free
 //
-#define MINFRAGMENT		64
-
+void Z_Free (void* ptr)
+{
+    if (!zoneshared)
+    {
+	Z_FreeBlock (ptr);
+	return;
+    }
+    I_Lock ();
+    Z_FreeBlock (ptr);
+    I_Unlock ();
+}
 
-void*
-Z_Malloc
-( int		size,
-  int		tag,
-  void*		user )
+//
+// Z_PurgeFree
+// Walks the block list from the rover, looking
+//  for the first free block of sufficient size,
+//  throwing out any purgable blocks along the way.
+//
+static memblock_t* Z_PurgeFree (int size)
 {
-    int		extra;
     memblock_t*	start;
     memblock_t* rover;
-    memblock_t* newblock;
     memblock_t*	base;
 
-    size = (size + 3) & ~3;
-    
-    // scan through the block list,
-    // looking for the first free block
-    // of sufficient size,
-    // throwing out any purgable blocks along the way.
-
-    // account for size of block header
-    size += sizeof(memblock_t);
-    
     // if there is a free block behind the rover,
     //  back up over them
     base = mainzone->rover;
@@ -214,12 +616,12 @@ Z_Malloc
 	if (rover == start)
 	{
 	    // scanned all the way around the list
-	    I_Error ("Z_Malloc: failed on allocation of %i bytes", size);
+	    return Z_AddSegment (size);
 	}
 	
 	if (rover->user)
 	{
-	    if (rover->tag < PU_PURGELEVEL)
+	    if (rover->tag < PU_PURGELEVEL || zoneshared)
 	    {
 		// hit a block that can't be purged,
 		//  so move base past it
@@ -228,6 +630,9 @@ Z_Malloc
 	    else
 	    {
 		// free the rover block (adding the size to base)
+		// let deferred users finish with it first
+		if (zonepurgefunc)
+		    zonepurgefunc ();
 
 		// the rover can be the base block
 		base = base->prev;
@@ -240,6 +645,83 @@ Z_Malloc
 	    rover = rover->next;
     } while (base->user || base->size < size);
 
+    return base;
+}
+
+
+//
+// Z_MallocBlock
+//
+static void*
+Z_MallocBlock
+( int		size,
+  int		tag,
+  void*		user )
+{
+    // plain level data goes to a pool or to the level arena
+    if (!user && (tag == PU_LEVEL || tag == PU_LEVSPEC))
+    {
+	if (size >= 0 && size <= MAXPOOLSIZE && poolbysize[size])
+	    return Z_PoolMalloc (&pools[poolbysize[size]-1], tag);
+	if (zonearena)
+	    return Z_ArenaMalloc (size, tag);
+    }
+
+    return Z_ZoneMalloc (size, tag, user);
+}
+
+
+//
+// Z_Malloc
+// You can pass a NULL user if the tag is < PU_PURGELEVEL.
+//
+void*
+Z_Malloc
+( int		size,
+  int		tag,
+  void*		user )
+{
+    void*	ptr;
+
+    if (!zoneshared)
+	return Z_MallocBlock (size, tag, user);
+
+    I_Lock ();
+    ptr = Z_MallocBlock (size, tag, user);
+    I_Unlock ();
+    return ptr;
+}
+
+
+//
+// Z_ZoneMalloc
+//
+#define MINFRAGMENT		64
+
+static void*
+Z_ZoneMalloc
+( int		size,
+  int		tag,
+  void*		user )
+{
+    int		extra;
+    memblock_t* newblock;
+    memblock_t*	base;
+
+    // a free block must hold its links
+    size = (size + ZONEALIGN-1) & ~(ZONEALIGN-1);
+    if (size < (int)sizeof(freelink_t))
+	size = (int)sizeof(freelink_t);
+
+    // account for size of block header
+    size += sizeof(memblock_t);
+
+    // most of the time, a bin has a free block
+    base = zonerover ? NULL : Z_FindFree (size);
+    if (!base)
+	base = Z_PurgeFree (size);
+
+    Z_UnlinkFree (base);
     
     // found a block big enough
     extra = base->size - size;
@@ -253,12 +735,15 @@ Z_Malloc
 	// NULL indicates free block.
 	newblock->user = NULL;	
 	newblock->tag = 0;
+	newblock->id = 0;
 	newblock->prev = base;
 	newblock->next = base->next;
 	newblock->next->prev = newblock;
 
 	base->next = newblock;
 	base->size = size;
+
+	Z_LinkFree (newblock);
     }
 	
     if (user)
@@ -276,6 +761,7 @@ Z_Malloc
 	base->user = (void *)2;		
     }
     base->tag = tag;
+    Z_CountTag (tag, base->size);
 
     // next allocation will start looking here
     mainzone->rover = base->next;	
@@ -287,6 +773,266 @@ Z_Malloc
 
 
 
+//
+// LEVEL ARENA
+//
+
+//
+// Z_NewArenaChunk
+// The first chunk of a level can be reserved,
+//  to hold the whole level at once.
+//
+static arenachunk_t* Z_NewArenaChunk (int size)
+{
+    arenachunk_t*	chunk;
+
+    size += sizeof(arenachunk_t);
+    if (!arenachunks && size < arenareserve)
+	size = arenareserve;
+    if (size < ARENACHUNK)
+	size = ARENACHUNK;
+
+    chunk = Z_ZoneMalloc (size, PU_LEVEL, NULL);
+    chunk->next = arenachunks;
+    chunk->size = size;
+    chunk->used = sizeof(arenachunk_t);
+    arenachunks = chunk;
+    return chunk;
+}
+
+
+//
+// Z_ArenaMalloc
+//
+static void* Z_ArenaMalloc (int size, int tag)
+{
+    arenablock_t*	block;
+    arenachunk_t*	chunk;
+    void*		ptr;
+
+    // a freed block must hold its link
+    size = (size + ZONEALIGN-1) & ~(ZONEALIGN-1);
+    if (size < (int)sizeof(void *))
+	size = (int)sizeof(void *);
+    size += sizeof(arenablock_t);
+
+    // a freed block of the same size comes back first
+    if (size <= ARENASMALL && arenafree[size/ZONEALIGN-1])
+    {
+	ptr = arenafree[size/ZONEALIGN-1];
+	arenafree[size/ZONEALIGN-1] = *(void **)ptr;
+	block = (arenablock_t *)ptr - 1;
+	block->tag = tag;
+	block->id = ARENAID;
+	return ptr;
+    }
+
+    chunk = arenachunks;
+    if (!chunk || chunk->used + size > chunk->size)
+	chunk = Z_NewArenaChunk (size);
+
+    block = (arenablock_t *) ((byte *)chunk + chunk->used);
+    chunk->used += size;
+    arenasize += size;
+
+    block->size = size <= ARENASMALL ? size/ZONEALIGN : 0;
+    block->tag = tag;
+    block->id = ARENAID;
+    return block + 1;
+}
+
+
+//
+// Z_ArenaFree
+// The space of a small block is kept for
+//  the next one of the same size.
+//
+static void Z_ArenaFree (arenablock_t* block)
+{
+    void*	ptr;
+
+    block->id = 0;
+    if (!block->size)
+	return;
+
+    ptr = block + 1;
+    *(void **)ptr = arenafree[block->size-1];
+    arenafree[block->size-1] = ptr;
+}
+
+
+//
+// Z_ResetArena
+// The chunks are PU_LEVEL zone blocks,
+//  Z_FreeTags gives them back to the zone.
+//
+static void Z_ResetArena (void)
+{
+    arenachunks = NULL;
+    arenasize = 0;
+    memset (arenafree, 0, sizeof(arenafree));
+}
+
+
+//
+// Z_ReserveArena
+// Sets the size of the first chunk after the next reset.
+//
+void Z_ReserveArena (int size)
+{
+    arenareserve = size + sizeof(arenachunk_t);
+}
+
+
+//
+// Z_ArenaSize
+// Returns the bytes used by the level arena.
+//
+int Z_ArenaSize (void)
+{
+    return arenasize;
+}
+
+
+
+//
+// SLAB POOLS
+//
+
+//
+// Z_InitPool
+// Blocks of that size now come from a pool.
+//
+void Z_InitPool (int size)
+{
+    zpool_t*	pool;
+
+    if (!g_pool || size <= 0 || size > MAXPOOLSIZE || poolbysize[size])
+	return;
+
+    if (numpools == MAXPOOLS)
+	I_Error ("Z_InitPool: no more than %i pools", MAXPOOLS);
+
+    pool = &pools[numpools++];
+    pool->size = size;
+    pool->slotsize = (sizeof(poolblock_t) + size + CACHELINE-1) & ~(CACHELINE-1);
+    pool->free = NULL;
+    pool->slab = pool->slabend = NULL;
+    poolbysize[size] = numpools;
+
+    I_Debug ("Z_InitPool: %i bytes objects in %i bytes slots",
+	     pool->size, pool->slotsize);
+}
+
+
+//
+// Z_PoolMalloc
+//
+static void* Z_PoolMalloc (zpool_t* pool, int tag)
+{
+    poolblock_t*	block;
+    byte*		slab;
+    void*		ptr;
+
+    if (pool->free)
+    {
+	ptr = pool->free;
+	pool->free = *(void **)ptr;
+	block = (poolblock_t *)ptr - 1;
+    }
+    else
+    {
+	if (pool->slab == pool->slabend)
+	{
+	    // a new slab, from the arena or the zone
+	    slab = zonearena
+		? Z_ArenaMalloc (POOLSLOTS*pool->slotsize + CACHELINE, PU_LEVEL)
+		: Z_Malloc (POOLSLOTS*pool->slotsize + CACHELINE, PU_LEVEL, NULL);
+	    pool->slab = (byte *) (((uintptr_t)slab + CACHELINE-1) & ~(uintptr_t)(CACHELINE-1));
+	    pool->slabend = pool->slab + POOLSLOTS*pool->slotsize;
+	}
+	block = (poolblock_t *)pool->slab;
+	pool->slab += pool->slotsize;
+	block->pool = pool - pools;
+    }
+
+    block->tag = tag;
+    block->id = POOLID;
+    return block + 1;
+}
+
+
+//
+// Z_PoolFree
+//
+static void Z_PoolFree (poolblock_t* block)
+{
+    zpool_t*	pool;
+    void*	ptr;
+
+    pool = &pools[block->pool];
+    block->id = 0;
+
+    ptr = block + 1;
+    *(void **)ptr = pool->free;
+    pool->free = ptr;
+}
+
+
+//
+// Z_ResetPools
+// The slabs are released with the level.
+//
+static void Z_ResetPools (void)
+{
+    int		i;
+
+    for (i=0 ; i<numpools ; i++)
+    {
+	pools[i].free = NULL;
+	pools[i].slab = pools[i].slabend = NULL;
+    }
+}
+
+
+
+//
+// MEMORY OUTSIDE OF THE ZONE
+//
+
+//
+// Z_AddExternal
+// Returns false if there are too many ranges.
+//
+boolean Z_AddExternal (void* base, int size)
+{
+    if (numexternal == MAXEXTERNAL)
+	return false;
+
+    externalbase[numexternal] = (byte *)base;
+    externalend[numexternal] = (byte *)base + size;
+    numexternal++;
+    return true;
+}
+
+
+//
+// Z_External
+//
+boolean Z_External (void* ptr)
+{
+    int		i;
+
+    for (i=0 ; i<numexternal ; i++)
+    {
+	if ((byte *)ptr >= externalbase[i] && (byte *)ptr < externalend[i])
+	    return true;
+    }
+    return false;
+}
+
+
+
 //
 // Z_FreeTags
 //
@@ -297,6 +1043,13 @@ Z_FreeTags
 {
     memblock_t*	block;
     memblock_t*	next;
+
+    // the slabs and the level arena go as a whole
+    if (lowtag <= PU_LEVEL && hightag >= PU_LEVSPEC)
+    {
+	Z_ResetPools ();
+	Z_ResetArena ();
+    }
 	
     for (block = mainzone->blocklist.next ;
 	 block != &mainzone->blocklist ;
@@ -345,7 +1098,7 @@ Z_DumpHeap
 	    break;
 	}
 	
-	if ( (byte *)block + block->size != (byte *)block->next)
+	if (!Z_FENCE(block) && (byte *)block + block->size != (byte *)block->next)
 	    I_Alert ("ERROR: block size does not touch the next block");
 
 	if ( block->next->prev != block)
@@ -377,7 +1130,7 @@ void Z_FileDumpHeap (FILE* f)
 	    break;
 	}
 	
-	if ( (byte *)block + block->size != (byte *)block->next)
+	if (!Z_FENCE(block) && (byte *)block + block->size != (byte *)block->next)
 	    fprintf (f,"ERROR: block size does not touch the next block\n");
 
 	if ( block->next->prev != block)
@@ -396,16 +1149,22 @@ void Z_FileDumpHeap (FILE* f)
 void Z_CheckHeap (void)
 {
     memblock_t*	block;
+    int		numfree;
+    int		bin;
 	
+    numfree = 0;
     for (block = mainzone->blocklist.next ; ; block = block->next)
     {
+	if (!block->user)
+	    numfree++;
+
 	if (block->next == &mainzone->blocklist)
 	{
 	    // all blocks have been hit
 	    break;
 	}
 	
-	if ( (byte *)block + block->size != (byte *)block->next)
+	if (!Z_FENCE(block) && (byte *)block + block->size != (byte *)block->next)
 	    I_Error ("Z_CheckHeap: block size does not touch the next block\n");
 
 	if ( block->next->prev != block)
@@ -414,21 +1173,47 @@ void Z_CheckHeap (void)
 	if (!block->user && !block->next->user)
 	    I_Error ("Z_CheckHeap: two consecutive free blocks\n");
     }
+
+    // every free block is in the bin of its size
+    for (bin=0 ; bin<NUMBINS ; bin++)
+    {
+	for (block = mainzone->bins[bin] ; block ; block = FREELINK(block)->next)
+	{
+	    if (block->user || Z_BinIndex (block->size) != bin)
+		I_Error ("Z_CheckHeap: block in the wrong bin\n");
+	    numfree--;
+	}
+    }
+
+    if (numfree)
+	I_Error ("Z_CheckHeap: free blocks missing from the bins\n");
 }
 
 
 
 
 //
-// Z_ChangeTag
+// Z_ChangeTagBlock
 //
-void
-Z_ChangeTag2
+static void
+Z_ChangeTagBlock
 ( void*		ptr,
   int		tag )
 {
     memblock_t*	block;
+
+    if (Z_External (ptr))
+	return;
 	
+    if (Z_BLOCKID(ptr) == ARENAID || Z_BLOCKID(ptr) == POOLID)
+    {
+	// an arena block or a slot lives until the level ends
+	if (tag != PU_LEVEL && tag != PU_LEVSPEC)
+	    I_Error ("Z_ChangeTag: tag %i for a level block", tag);
+	((arenablock_t *)ptr - 1)->tag = tag;
+	return;
+    }
+
     block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
 
     if (block->id != ZONEID)
@@ -437,11 +1222,32 @@ Z_ChangeTag2
     if (tag >= PU_PURGELEVEL && (unsigned long)block->user < 0x100)
 	I_Error ("Z_ChangeTag: an owner is required for purgable blocks");
 
+    Z_CountTag (block->tag, -block->size);
+    Z_CountTag (tag, block->size);
     block->tag = tag;
 }
 
 
 
+
+//
+// Z_ChangeTag
+//
+void
+Z_ChangeTag2
+( void*		ptr,
+  int		tag )
+{
+    if (!zoneshared)
+    {
+	Z_ChangeTagBlock (ptr, tag);
+	return;
+    }
+    I_Lock ();
+    Z_ChangeTagBlock (ptr, tag);
+    I_Unlock ();
+}
+
 //
 // Z_FreeMemory
 //
@@ -462,3 +1268,149 @@ int Z_FreeMemory (void)
     return free;
 }
 
+
+
+//
+// Z_PrintUsage
+// The zone size and the peak bytes in use by tag.
+//
+void Z_PrintUsage (void)
+{
+    int		tag;
+
+    I_Print ("Z_PrintUsage: %i KB in %i segments, peak %i KB in use",
+	     mainzone->size / 1024, mainzone->numsegments, zonepeak / 1024);
+
+    for (tag=0 ; tag<NUMTAGS ; tag++)
+    {
+	if (zonetagpeak[tag])
+	    I_Print ("Z_PrintUsage: tag %3i peak %7i KB, now %7i KB",
+		     tag, zonetagpeak[tag] / 1024, zonetagused[tag] / 1024);
+    }
+}
+
+
+
+//
+// Z_Benchmark
+// Times the bins against the rover walk alone,
+//  on a level load and on spawn heavy play.
+//
+#define BENCHLEVEL	8000
+#define BENCHCACHE	512
+#define BENCHLIVE	1024
+#define BENCHSPAWNS	200000
+
+static unsigned	benchseed;
+static void*	benchcache[BENCHCACHE];
+static void*	benchlive[BENCHLIVE];
+
+static int Z_BenchRandom (void)
+{
+    benchseed ^= benchseed << 13;
+    benchseed ^= benchseed >> 17;
+    benchseed ^= benchseed << 5;
+    return benchseed & 0x7fffffff;
+}
+
+// Level geometry and thinkers,
+//  with lumps cached along the way.
+static int Z_BenchLevel (void)
+{
+    int		i;
+    int		size;
+    int		ops;
+
+    ops = 0;
+    for (i=0 ; i<BENCHLEVEL ; i++)
+    {
+	if (i % 64 == 63)
+	    size = 4096 + Z_BenchRandom () % 16384;
+	else
+	    size = 16 + Z_BenchRandom () % 256;
+	Z_Malloc (size, PU_LEVEL, 0);
+	ops++;
+
+	if (i % 16 == 15)
+	{
+	    Z_Malloc (1024 + Z_BenchRandom () % 8192, PU_CACHE,
+		      &benchcache[Z_BenchRandom () % BENCHCACHE]);
+	    ops++;
+	}
+    }
+
+    Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
+    return ops;
+}
+
+// Mobjs and special thinkers coming and going
+//  in a fragmented level.
+static int Z_BenchSpawn (void)
+{
+    void**	slot;
+    int		i;
+    int		ops;
+
+    for (i=0 ; i<BENCHLEVEL ; i++)
+    {
+	benchlive[i % BENCHLIVE] = Z_Malloc (16 + Z_BenchRandom () % 512,
+					     PU_LEVEL, 0);
+	if (i % 2)
+	    Z_Free (benchlive[i % BENCHLIVE]);
+    }
+    memset (benchlive, 0, sizeof(benchlive));
+
+    ops = 0;
+    for (i=0 ; i<BENCHSPAWNS ; i++)
+    {
+	slot = &benchlive[Z_BenchRandom () % BENCHLIVE];
+	if (*slot)
+	{
+	    Z_Free (*slot);
+	    *slot = NULL;
+	}
+	else
+	    *slot = Z_Malloc (Z_BenchRandom () % 4 ? 200 : 64, PU_LEVEL, 0);
+	ops++;
+    }
+
+    memset (benchlive, 0, sizeof(benchlive));
+    Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
+    return ops;
+}
+
+void Z_Benchmark (void)
+{
+    int		(*workload[2]) (void) = { Z_BenchLevel, Z_BenchSpawn };
+    char*	names[2] = { "level load", "spawn heavy" };
+    double	ns[3];
+    int64_t	start;
+    int		ops;
+    int		i;
+    int		j;
+
+    I_Print ("Z_Benchmark: %i KB zone", mainzone->size / 1024);
+    for (i=0 ; i<2 ; i++)
+    {
+	// the rover alone, the bins, then the level arena
+	for (j=0 ; j<3 ; j++)
+	{
+	    Z_ClearZone (mainzone);
+	    memset (benchcache, 0, sizeof(benchcache));
+	    benchseed = 0x1d4a11;
+	    zonerover = (j == 0);
+	    zonearena = (j == 2);
+
+	    start = I_GetTimeNS ();
+	    ops = workload[i] ();
+	    ops += workload[i] ();
+	    ns[j] = (double)(I_GetTimeNS () - start) / ops;
+
+	    Z_CheckHeap ();
+	}
+	I_Print ("Z_Benchmark: %-12s rover %8.1f ns/op, bins %8.1f ns/op,"
+		 " arena %8.1f ns/op", names[i], ns[0], ns[1], ns[2]);
+    }
+    zonerover = false;
+    zonearena = g_arena;
+}
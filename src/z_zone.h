@@ -29,6 +29,8 @@
 
 #include <stdio.h>
 
+#include "doomtype.h"
+
 //
 // ZONE MEMORY
 // PU - purge tags.
@@ -53,25 +55,76 @@ void    Z_FileDumpHeap (FILE *f);
 void    Z_CheckHeap (void);
 void    Z_ChangeTag2 (void *ptr, int tag);
 int     Z_FreeMemory (void);
+void    Z_PrintUsage (void);
+void    Z_Benchmark (void);
+
+// The level arena, where Z_Malloc puts the PU_LEVEL
+//  and PU_LEVSPEC blocks without a user.
+// It is released at once by Z_FreeTags.
+void    Z_ReserveArena (int size);
+int     Z_ArenaSize (void);
+
+// Slab pools, where Z_Malloc puts the PU_LEVEL and
+//  PU_LEVSPEC blocks without a user of a pooled size,
+//  e.g. mobjs and special thinkers.
+void    Z_InitPool (int size);
+
+// Memory outside of the zone, e.g. a mapped WAD file,
+//  to be left alone by Z_Free and Z_ChangeTag.
+boolean Z_AddExternal (void *base, int size);
+boolean Z_External (void *ptr);
+
+// Called before a purgable block is thrown out,
+//  e.g. to flush deferred drawing using it.
+extern void	(*zonepurgefunc) (void);
+
+// Set while the startup tasks run on several threads,
+//  Z_Malloc, Z_Free and Z_ChangeTag are serialized
+//  and nothing is purged.
+extern boolean	zoneshared;
+
 
+#define ZONEID	0x1d4a11
+#define ARENAID	0x1d4a12
+#define POOLID	0x1d4a13
 
 typedef struct memblock_s
 {
     int			size;	// including the header and possibly tiny fragments
     void**		user;	// NULL if a free block
-    int			tag;	// purgelevel
-    int			id;	// should be ZONEID
     struct memblock_s*	next;
     struct memblock_s*	prev;
+    int			tag;	// purgelevel
+    int			id;	// should be ZONEID, and last
 } memblock_t;
 
+// A level arena block, it ends like memblock_t.
+typedef struct
+{
+    short		size;	// in 8 bytes units, 0 if not recycled
+    short		tag;	// PU_LEVEL or PU_LEVSPEC
+    int			id;	// should be ARENAID
+} arenablock_t;
+
+// A slab pool slot, it ends like memblock_t.
+typedef struct
+{
+    short		pool;
+    short		tag;	// PU_LEVEL or PU_LEVSPEC
+    int			id;	// should be POOLID
+} poolblock_t;
+
+// Every block header ends with its id.
+#define Z_BLOCKID(p)	(((int *)(p))[-1])
+
 //
 // This is used to get the local FILE:LINE info from CPP
 // prior to really call the function in question.
 //
 #define Z_ChangeTag(p,t) \
 { \
-    if (( (memblock_t *)( (byte *)(p) - sizeof(memblock_t)))->id!=0x1d4a11) \
+    if (!Z_External(p) \
+        && Z_BLOCKID(p)!=ZONEID && Z_BLOCKID(p)!=ARENAID && Z_BLOCKID(p)!=POOLID) \
         I_Error("Z_CT at "__FILE__":%i",__LINE__); \
     Z_ChangeTag2(p,t); \
 };